@@ -0,0 +1,158 @@
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Physics/CollisionShape.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+
+#include "Arena.h"
+#include "Messages.h"
+
+Arena::~Arena() {
+    // Boid nodes are local and outlive a Scene::Clear, the first arena's scene is kept for the next match
+    boids.Clear();
+    for (HashMap<Connection*, Player*>::Iterator i = players.Begin(); i != players.End(); ++i) delete i->second_;
+}
+
+void Arena::AddConnection(Connection* connection) {
+    connections.Push(SharedPtr<Connection>(connection));
+    connection->SetScene(scene);
+}
+
+void Arena::RemoveConnection(Connection* connection) {
+    Player* player = GetPlayer(connection);
+    if (player) player->pNode->Remove();
+
+    // The connection is about to be destroyed, don't leave it behind for the checkpoint to read
+    players.Erase(connection);
+    snapshots.RemoveConnection(connection);
+    connections.Remove(SharedPtr<Connection>(connection));
+    delete player;
+}
+
+Player* Arena::GetPlayer(Connection* connection) const {
+    HashMap<Connection*, Player*>::ConstIterator i = players.Find(connection);
+    return i != players.End() ? i->second_ : nullptr;
+}
+
+void Arena::GatherPlayerPositions() {
+    playerPositions.Clear();
+    for (HashMap<Connection*, Player*>::ConstIterator i = players.Begin(); i != players.End(); ++i) {
+        if (i->second_ && i->second_->pNode) playerPositions.Push(i->second_->pRigidBody->GetPosition());
+    }
+
+    wakePositions = playerPositions;
+    wakePositions += observers;
+}
+
+void Arena::UpdateRelayed() {
+    // The identity arrives after the connection, so this runs every network update. A relay has no position of its
+    // own to be near to and must get every player at full rate; priority is per node rather than per connection, so
+    // the other clients of a relayed arena do too.
+    bool hasRelay = false;
+    for (unsigned i = 0; i < connections.Size() && !hasRelay; i++) {
+        VariantMap::ConstIterator relay = connections[i]->GetIdentity().Find(SPECTATOR_RELAY);
+        hasRelay = relay != connections[i]->GetIdentity().End() && relay->second_.GetBool();
+    }
+    if (hasRelay == relayed) return;
+
+    relayed = hasRelay;
+    for (HashMap<Connection*, Player*>::Iterator i = players.Begin(); i != players.End(); ++i) {
+        i->second_->SetDistancePriority(!relayed);
+    }
+}
+
+Scene* CreateArenaScene(Context* context) {
+    Scene* scene = new Scene(context);
+    scene->CreateComponent<Octree>(LOCAL);
+    scene->CreateComponent<PhysicsWorld>(LOCAL);
+
+    Node* floorNode = scene->CreateChild("Floor", LOCAL);
+    floorNode->SetPosition(Vector3(0.0f, -0.5f, 0.0f));
+    floorNode->SetScale(Vector3(200.0f, 1.0f, 200.0f));
+
+    RigidBody* rigidbody = floorNode->CreateComponent<RigidBody>(LOCAL);
+    rigidbody->SetCollisionLayer(2);
+    CollisionShape* shape = floorNode->CreateComponent<CollisionShape>(LOCAL);
+    shape->SetBox(Vector3::ONE);
+
+    Node* wallNode1 = scene->CreateChild("Wall", LOCAL);
+    wallNode1->SetPosition(Vector3(100.5f, 25.0f, 0.0f));
+    wallNode1->SetScale(Vector3(1.0f, 50.0f, 200.0f));
+
+    Node* wallNode2 = scene->CreateChild("Wall", LOCAL);
+    wallNode2->SetPosition(Vector3(-100.5f, 25.0f, 0.0f));
+    wallNode2->SetScale(Vector3(1.0f, 50.0f, 200.0f));
+
+    Node* wallNode3 = scene->CreateChild("Wall", LOCAL);
+    wallNode3->SetPosition(Vector3(0.0f, 25.0f, 100.5f));
+    wallNode3->SetScale(Vector3(200.0f, 50.0f, 1.0f));
+
+    Node* wallNode4 = scene->CreateChild("Wall", LOCAL);
+    wallNode4->SetPosition(Vector3(0.0f, 25.0f, -100.5f));
+    wallNode4->SetScale(Vector3(200.0f, 50.0f, 1.0f));
+
+    RigidBody* wallBody1 = wallNode1->CreateComponent<RigidBody>(LOCAL);
+    RigidBody* wallBody2 = wallNode2->CreateComponent<RigidBody>(LOCAL);
+    RigidBody* wallBody3 = wallNode3->CreateComponent<RigidBody>(LOCAL);
+    RigidBody* wallBody4 = wallNode4->CreateComponent<RigidBody>(LOCAL);
+    wallBody1->SetCollisionLayer(2);
+    wallBody2->SetCollisionLayer(2);
+    wallBody3->SetCollisionLayer(2);
+    wallBody4->SetCollisionLayer(2);
+    CollisionShape* wallShape1 = wallNode1->CreateComponent<CollisionShape>(LOCAL);
+    CollisionShape* wallShape2 = wallNode2->CreateComponent<CollisionShape>(LOCAL);
+    CollisionShape* wallShape3 = wallNode3->CreateComponent<CollisionShape>(LOCAL);
+    CollisionShape* wallShape4 = wallNode4->CreateComponent<CollisionShape>(LOCAL);
+    wallShape1->SetBox(Vector3::ONE);
+    wallShape2->SetBox(Vector3::ONE);
+    wallShape3->SetBox(Vector3::ONE);
+    wallShape4->SetBox(Vector3::ONE);
+
+    return scene;
+}
+
+Arena* AssignArena(const Vector<SharedPtr<Arena> >& arenas, unsigned capacity) {
+    Arena* leastLoaded = nullptr;
+
+    for (unsigned i = 0; i < arenas.Size(); i++) {
+        if (arenas[i]->connections.Size() < capacity) return arenas[i];
+        if (!leastLoaded || arenas[i]->connections.Size() < leastLoaded->connections.Size()) leastLoaded = arenas[i];
+    }
+
+    return leastLoaded;
+}
+
+static void FlockWork(const WorkItem* item, unsigned threadIndex) {
+    Arena* arena = static_cast<Arena*>(item->start_);
+    HiresTimer timer;
+
+    TickScratch* scratch = static_cast<TickScratch*>(item->aux_);
+
+    arena->boids.ComputeForces(arena->playerPositions, scratch->Get(threadIndex));
+    arena->flockTime = timer.GetUSec(false) / 1000.0f;
+}
+
+void FlockArenas(WorkQueue* queue, const Vector<SharedPtr<Arena> >& arenas, float timeStep) {
+    for (unsigned i = 0; i < arenas.Size(); i++) {
+        arenas[i]->GatherPlayerPositions();
+        arenas[i]->boids.UpdateRegions(arenas[i]->wakePositions, timeStep);
+    }
+
+    ComputeArenaForces(queue, arenas);
+}
+
+void ComputeArenaForces(WorkQueue* queue, const Vector<SharedPtr<Arena> >& arenas) {
+    for (unsigned i = 0; i < arenas.Size(); i++) {
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = FlockWork;
+        item->start_ = arenas[i];
+        item->aux_ = queue->GetSubsystem<TickScratch>();
+        queue->AddWorkItem(item);
+    }
+
+    // The main thread works through the queue too while it waits
+    queue->Complete(M_MAX_UNSIGNED);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "Boids.h"
+#include "BoidSnapshot.h"
+#include "Player.h"
+
+namespace Urho3D {
+    class Connection;
+    class WorkQueue;
+}
+
+using namespace Urho3D;
+
+const static int ArenaStepRate = 60; // Physics steps per second, each preceded by its own flocking pass
+
+// One independent match: its own scene and physics world, flock, players and snapshot history
+class Arena : public RefCounted {
+public:
+    unsigned index;
+    SharedPtr<Scene> scene;
+    BoidSet boids;
+    HashMap<Connection*, Player*> players;
+    SnapshotServer snapshots;
+    Vector<SharedPtr<Connection> > connections; // Assigned to this arena, including ones not yet playing
+    Vector<Vector3> playerPositions; // Gathered on the main thread before flocking
+    Vector<Vector3> observers; // Keep regions awake without being flocked around, such as the listen server's camera
+    Vector<Vector3> wakePositions; // Players and observers
+    float flockTime = 0.0f; // Milliseconds spent on the last flocking pass
+    bool relayed = false; // A spectator relay is connected, players are replicated without distance priority
+
+    // Methods
+    Arena(unsigned arenaIndex) : index(arenaIndex) {}
+    ~Arena();
+    void AddConnection(Connection* connection);
+    void RemoveConnection(Connection* connection);
+    Player* GetPlayer(Connection* connection) const;
+    void GatherPlayerPositions();
+    void UpdateRelayed();
+};
+
+// Scene with the physics floor and walls shared by every arena, and nothing to look at
+Scene* CreateArenaScene(Context* context);
+
+// Fills arenas in order up to capacity, then spreads the overflow to the least loaded
+Arena* AssignArena(const Vector<SharedPtr<Arena> >& arenas, unsigned capacity);
+
+// Wakes and puts to sleep each arena's regions, then computes the flocking forces of every arena in parallel on the
+// work queue. Flocking only reads boid and player state and writes each boid's force, so arenas don't share
+// anything; physics and events stay on the main thread.
+void FlockArenas(WorkQueue* queue, const Vector<SharedPtr<Arena> >& arenas, float timeStep);
+
+// The parallel part of FlockArenas on its own, for arenas whose player positions are already gathered
+void ComputeArenaForces(WorkQueue* queue, const Vector<SharedPtr<Arena> >& arenas);
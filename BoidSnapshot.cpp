@@ -0,0 +1,531 @@
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/IO/Compression.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Scene/Scene.h>
+#include <cmath>
+#include <cstring>
+
+#include "BoidSnapshot.h"
+#include "Messages.h"
+
+static unsigned short QuantizeRange(float value, float min, float max) {
+    float t = Clamp((value - min) / (max - min), 0.0f, 1.0f);
+    return (unsigned short)(t * 65535.0f + 0.5f);
+}
+
+static float DequantizeRange(unsigned short value, float min, float max) {
+    return min + (max - min) * (value / 65535.0f);
+}
+
+static unsigned ZigZag(int value) {
+    return (unsigned)((value << 1) ^ (value >> 31));
+}
+
+static int UnZigZag(unsigned value) {
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+static signed char QuantizeVelocity(float value) {
+    return (signed char)RoundToInt(Clamp(value / VelocityRange, -1.0f, 1.0f) * 127.0f);
+}
+
+QuantizedBoid QuantizeBoid(const Vector3& position, const Vector3& velocity, float yaw, bool isBig, bool alive) {
+    QuantizedBoid boid = {};
+    boid.x = QuantizeRange(position.x_, -ArenaHalfSize, ArenaHalfSize);
+    boid.y = QuantizeRange(position.y_, 0.0f, ArenaHeight);
+    boid.z = QuantizeRange(position.z_, -ArenaHalfSize, ArenaHalfSize);
+
+    float heading = fmodf(yaw, 360.0f);
+    if (heading < 0.0f) heading += 360.0f;
+    boid.heading = (unsigned char)((int)(heading * 256.0f / 360.0f + 0.5f) & 0xff);
+
+    boid.vx = QuantizeVelocity(velocity.x_);
+    boid.vy = QuantizeVelocity(velocity.y_);
+    boid.vz = QuantizeVelocity(velocity.z_);
+
+    boid.flags = (alive ? BOID_ALIVE : 0) | (isBig ? BOID_BIG : 0);
+    return boid;
+}
+
+Vector3 DequantizePosition(const QuantizedBoid& boid) {
+    return Vector3(DequantizeRange(boid.x, -ArenaHalfSize, ArenaHalfSize),
+        DequantizeRange(boid.y, 0.0f, ArenaHeight),
+        DequantizeRange(boid.z, -ArenaHalfSize, ArenaHalfSize));
+}
+
+Vector3 DequantizeVelocity(const QuantizedBoid& boid) {
+    return Vector3(boid.vx, boid.vy, boid.vz) * (VelocityRange / 127.0f);
+}
+
+static bool SameBoid(const QuantizedBoid& a, const QuantizedBoid& b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z && a.heading == b.heading && a.flags == b.flags &&
+        a.vx == b.vx && a.vy == b.vy && a.vz == b.vz;
+}
+
+float DequantizeHeading(const QuantizedBoid& boid) {
+    return boid.heading * 360.0f / 256.0f;
+}
+
+void WriteBoidSnapshot(VectorBuffer& dest, unsigned id, unsigned baseId, const PODVector<QuantizedBoid>& boids, const PODVector<QuantizedBoid>* base) {
+    static const QuantizedBoid zero = {};
+    unsigned count = boids.Size();
+
+    dest.Clear();
+    dest.WriteUInt(id);
+    dest.WriteUInt(baseId);
+    dest.WriteVLE(count);
+
+    // One bit per boid marking which ones differ from the base
+    unsigned maskOffset = dest.GetPosition();
+    for (unsigned i = 0; i < (count + 7) / 8; i++) dest.WriteUByte(0);
+
+    for (unsigned i = 0; i < count; i++) {
+        const QuantizedBoid& prev = base && i < base->Size() ? (*base)[i] : zero;
+        const QuantizedBoid& cur = boids[i];
+
+        if (SameBoid(cur, prev)) continue;
+
+        dest.GetModifiableData()[maskOffset + i / 8] |= 1 << (i % 8);
+        dest.WriteVLE(ZigZag((int)cur.x - (int)prev.x));
+        dest.WriteVLE(ZigZag((int)cur.y - (int)prev.y));
+        dest.WriteVLE(ZigZag((int)cur.z - (int)prev.z));
+        dest.WriteUByte(cur.heading);
+        dest.WriteUByte(cur.flags);
+        dest.WriteByte(cur.vx);
+        dest.WriteByte(cur.vy);
+        dest.WriteByte(cur.vz);
+    }
+}
+
+bool ReadBoidSnapshot(MemoryBuffer& source, PODVector<QuantizedBoid>& boids, const PODVector<QuantizedBoid>* base) {
+    static const QuantizedBoid zero = {};
+
+    unsigned count = source.ReadVLE();
+    unsigned maskOffset = source.GetPosition();
+    unsigned maskSize = (count + 7) / 8;
+    if (maskOffset + maskSize > source.GetSize()) return false;
+
+    const unsigned char* mask = source.GetData() + maskOffset;
+    source.Seek(maskOffset + maskSize);
+    boids.Resize(count);
+
+    for (unsigned i = 0; i < count; i++) {
+        const QuantizedBoid& prev = base && i < base->Size() ? (*base)[i] : zero;
+        QuantizedBoid& cur = boids[i];
+
+        if (!(mask[i / 8] & (1 << (i % 8)))) {
+            cur = prev;
+            continue;
+        }
+
+        cur.x = (unsigned short)((int)prev.x + UnZigZag(source.ReadVLE()));
+        cur.y = (unsigned short)((int)prev.y + UnZigZag(source.ReadVLE()));
+        cur.z = (unsigned short)((int)prev.z + UnZigZag(source.ReadVLE()));
+        cur.heading = source.ReadUByte();
+        cur.flags = source.ReadUByte();
+        cur.vx = source.ReadByte();
+        cur.vy = source.ReadByte();
+        cur.vz = source.ReadByte();
+        cur.padding = 0;
+    }
+
+    return true;
+}
+
+// Each field byte of all boids in a chunk is stored contiguously, which LZ4 compresses far better than whole structs:
+// flags, headings and the high position bytes are mostly runs
+static const unsigned JoinPlanes = 11;
+
+static void PackPlanes(const QuantizedBoid* boids, unsigned count, unsigned char* dest) {
+    for (unsigned i = 0; i < count; i++) {
+        const QuantizedBoid& boid = boids[i];
+        dest[i] = (unsigned char)(boid.x & 0xff);
+        dest[count + i] = (unsigned char)(boid.x >> 8);
+        dest[2 * count + i] = (unsigned char)(boid.y & 0xff);
+        dest[3 * count + i] = (unsigned char)(boid.y >> 8);
+        dest[4 * count + i] = (unsigned char)(boid.z & 0xff);
+        dest[5 * count + i] = (unsigned char)(boid.z >> 8);
+        dest[6 * count + i] = boid.heading;
+        dest[7 * count + i] = boid.flags;
+        dest[8 * count + i] = (unsigned char)boid.vx;
+        dest[9 * count + i] = (unsigned char)boid.vy;
+        dest[10 * count + i] = (unsigned char)boid.vz;
+    }
+}
+
+static void UnpackPlanes(const unsigned char* source, unsigned count, QuantizedBoid* boids) {
+    for (unsigned i = 0; i < count; i++) {
+        QuantizedBoid& boid = boids[i];
+        boid.x = (unsigned short)(source[i] | source[count + i] << 8);
+        boid.y = (unsigned short)(source[2 * count + i] | source[3 * count + i] << 8);
+        boid.z = (unsigned short)(source[4 * count + i] | source[5 * count + i] << 8);
+        boid.heading = source[6 * count + i];
+        boid.flags = source[7 * count + i];
+        boid.vx = (signed char)source[8 * count + i];
+        boid.vy = (signed char)source[9 * count + i];
+        boid.vz = (signed char)source[10 * count + i];
+        boid.padding = 0;
+    }
+}
+
+void WriteJoinHeader(VectorBuffer& dest, unsigned id, unsigned count) {
+    dest.Clear();
+    dest.WriteUInt(id);
+    dest.WriteVLE(count);
+    dest.WriteVLE(0);
+    dest.WriteVLE(0);
+
+    // Static arena parameters the packed state depends on
+    dest.WriteFloat(ArenaHalfSize);
+    dest.WriteFloat(ArenaHeight);
+    dest.WriteFloat(VelocityRange);
+}
+
+void WriteJoinChunk(VectorBuffer& dest, unsigned id, const PODVector<QuantizedBoid>& boids, unsigned start, unsigned count) {
+    PODVector<unsigned char> planes(count * JoinPlanes);
+    PackPlanes(&boids[start], count, &planes[0]);
+
+    dest.Clear();
+    dest.WriteUInt(id);
+    dest.WriteVLE(boids.Size());
+    dest.WriteVLE(start);
+    dest.WriteVLE(count);
+
+    unsigned offset = dest.GetPosition();
+    dest.Resize(offset + EstimateCompressBound(planes.Size()));
+    dest.Resize(offset + CompressData(dest.GetModifiableData() + offset, &planes[0], planes.Size()));
+}
+
+PODVector<QuantizedBoid>& SnapshotRing::Store(unsigned id) {
+    ids_[id % SnapshotHistory] = id;
+    return snapshots_[id % SnapshotHistory];
+}
+
+const PODVector<QuantizedBoid>* SnapshotRing::Find(unsigned id) const {
+    if (id == 0 || ids_[id % SnapshotHistory] != id) return nullptr;
+    return &snapshots_[id % SnapshotHistory];
+}
+
+unsigned SnapshotRing::GetMemoryUse() const {
+    unsigned bytes = 0;
+    for (unsigned i = 0; i < SnapshotHistory; i++) bytes += snapshots_[i].Capacity() * sizeof(QuantizedBoid);
+    return bytes;
+}
+
+void SnapshotServer::SetState(BoidSet& boids) {
+    unsigned count = boids.boidList.Size();
+
+    current_.Resize(count);
+    cells_.Resize(count);
+    for (unsigned i = 0; i < count; i++) {
+        Boid& boid = boids.boidList[i];
+        current_[i] = QuantizeBoid(boid.pNode->GetPosition(), boid.pRigidBody->GetLinearVelocity(), boid.pNode->GetRotation().YawAngle(),
+            boid.isBig, boid.pNode->IsEnabled());
+        cells_[i] = (unsigned short)(boid.gridX * GridSize + boid.gridZ);
+    }
+}
+
+void SnapshotServer::SetState(const PODVector<QuantizedBoid>& boids) {
+    float halfGrid = GridSize * GridCellSize * 0.5f;
+    unsigned count = boids.Size();
+
+    current_ = boids;
+    cells_.Resize(count);
+    for (unsigned i = 0; i < count; i++) {
+        // Same cells as BoidSet::UpdateGrid
+        Vector3 position = DequantizePosition(boids[i]);
+        int x = Clamp((int)((position.x_ + halfGrid) / GridCellSize), 0, GridSize - 1);
+        int z = Clamp((int)((position.z_ + halfGrid) / GridCellSize), 0, GridSize - 1);
+        cells_[i] = (unsigned short)(x * GridSize + z);
+    }
+}
+
+void SnapshotServer::Send(const Vector<SharedPtr<Connection> >& connections, float timeStep) {
+    static const QuantizedBoid zero = {};
+    unsigned id = nextId_++;
+    unsigned count = current_.Size();
+
+    for (unsigned i = 0; i < connections.Size(); i++) {
+        Connection* connection = connections[i];
+        if (!connection->GetScene()) continue;
+
+        SnapshotView& view = views_[connection];
+        const VariantMap& extraData = connection->GetControls().extraData_;
+
+        // A new connection is streamed the flock as it is now, regular snapshots follow as deltas against it
+        if (!view.joinId) {
+            VariantMap::ConstIterator relay = connection->GetIdentity().Find(SPECTATOR_RELAY);
+            view.relay = relay != connection->GetIdentity().End() && relay->second_.GetBool();
+            view.joinId = id;
+            view.joinBase = current_;
+            WriteJoinHeader(message_, id, count);
+            SendJoin(connection, view);
+        }
+        if (view.joinSent < view.joinBase.Size()) {
+            unsigned num = Min(JoinChunkBoids, view.joinBase.Size() - view.joinSent);
+            WriteJoinChunk(message_, view.joinId, view.joinBase, view.joinSent, num);
+            view.joinSent += num;
+            SendJoin(connection, view);
+            continue;
+        }
+
+        // Relays fan out to their own spectators and get everything at full rate
+        VariantMap::ConstIterator received = extraData.Find(SNAPSHOT_COUNT);
+        if (!view.relay) view.rate.Update(timeStep, connection->GetRoundTripTime(), received != extraData.End() ? received->second_.GetUInt() : 0);
+        const QualityLevel& quality = view.relay ? QualityLevels[0] : view.rate.GetQuality();
+        if (stats && !view.relay) stats->SetSnapshotRate(connection, 1.0f / (timeStep * quality.sendInterval), view.rate.budget, view.rate.usage);
+        if (id % quality.sendInterval) continue;
+
+        // Fall back to a full snapshot when the acked one is no longer in the history
+        VariantMap::ConstIterator ack = extraData.Find(SNAPSHOT_ACK);
+        unsigned ackId = ack != extraData.End() ? ack->second_.GetUInt() : 0;
+        const PODVector<QuantizedBoid>* base = ackId + SnapshotHistory > id ? view.sent.Find(ackId) : nullptr;
+
+        // The join snapshot is reliable, so it can be the base before the client has acked anything
+        if (ackId > view.joinId && !view.joinBase.Empty()) {
+            view.joinBase.Clear();
+            view.joinBase.Compact();
+        } else if (!base && view.joinId + SnapshotHistory > id) {
+            base = &view.joinBase;
+            ackId = view.joinId;
+        }
+
+        if (view.relay) memset(cellTiers_, INTEREST_NEAR, sizeof(cellTiers_));
+        else UpdateInterest(connection->GetPosition());
+
+        PODVector<QuantizedBoid>& sent = view.sent.Store(id);
+        sent.Resize(count);
+        view.numNear = view.numMid = view.numSent = 0;
+
+        unsigned interval = midInterval * quality.midScale;
+        for (unsigned j = 0; j < count; j++) {
+            unsigned char tier = cellTiers_[cells_[j]];
+            const QuantizedBoid* previous = base && j < base->Size() ? &(*base)[j] : nullptr;
+            bool include = tier == INTEREST_NEAR;
+            bool hide = false;
+
+            // Mid tier boids go out on their slot, and at once when the client doesn't have them: without a base, or
+            // after being hidden. While congestion drops the mid tier they are hidden, rather than left where they
+            // were for the client to hold in place.
+            if (tier == INTEREST_MID) {
+                if (!interval) {
+                    hide = true;
+                } else {
+                    bool wasHidden = previous && !(previous->flags & BOID_ALIVE) && (current_[j].flags & BOID_ALIVE);
+                    include = !previous || wasHidden || (id + j) % interval == 0;
+                }
+            }
+
+            if (tier == INTEREST_NEAR) view.numNear++;
+            else if (tier == INTEREST_MID) view.numMid++;
+
+            if (include) {
+                sent[j] = current_[j];
+                view.numSent++;
+            } else if (hide) {
+                // Kept at the base position, so after the first snapshot a hidden boid costs nothing in the delta
+                sent[j] = previous ? *previous : current_[j];
+                sent[j].flags &= ~BOID_ALIVE;
+            } else {
+                sent[j] = previous ? *previous : zero;
+            }
+        }
+
+        WriteBoidSnapshot(message_, id, base ? ackId : 0, sent, base);
+        connection->SendMessage(MSG_BOIDSNAPSHOT, false, false, message_);
+        bytesSent += message_.GetSize();
+        view.rate.OnSent(message_.GetSize());
+        if (stats) stats->Count(connection, NET_SNAPSHOTS, message_.GetSize());
+    }
+}
+
+void SnapshotServer::SendJoin(Connection* connection, SnapshotView& view) {
+    connection->SendMessage(MSG_JOINSNAPSHOT, true, true, message_);
+    view.joinBytes += message_.GetSize();
+    if (stats) stats->Count(connection, NET_JOIN, message_.GetSize());
+
+    if (view.joinSent == view.joinBase.Size()) {
+        URHO3D_LOGINFOF("Join snapshot: %s %u boids in %u bytes, %u uncompressed", connection->ToString().CString(),
+            view.joinBase.Size(), view.joinBytes, view.joinBase.Size() * (unsigned)sizeof(QuantizedBoid));
+    }
+}
+
+const SnapshotView* SnapshotServer::GetView(Connection* connection) const {
+    HashMap<Connection*, SnapshotView>::ConstIterator i = views_.Find(connection);
+    return i != views_.End() ? &i->second_ : nullptr;
+}
+
+unsigned SnapshotServer::GetMemoryUse() const {
+    unsigned bytes = current_.Capacity() * sizeof(QuantizedBoid) + cells_.Capacity() * sizeof(unsigned short);
+    bytes += message_.GetBuffer().Capacity();
+    for (HashMap<Connection*, SnapshotView>::ConstIterator i = views_.Begin(); i != views_.End(); ++i) {
+        bytes += sizeof(SnapshotView) + i->second_.sent.GetMemoryUse() + i->second_.joinBase.Capacity() * sizeof(QuantizedBoid);
+    }
+    return bytes;
+}
+
+void SnapshotServer::UpdateInterest(const Vector3& position) {
+    // Distance to the nearest point of each cell, so a boid is never classified further away than it is
+    float halfCell = GridCellSize * 0.5f;
+    float origin = -GridSize * GridCellSize * 0.5f;
+
+    for (int x = 0; x < GridSize; x++) {
+        for (int z = 0; z < GridSize; z++) {
+            float dx = Max(Abs(position.x_ - (origin + (x + 0.5f) * GridCellSize)) - halfCell, 0.0f);
+            float dz = Max(Abs(position.z_ - (origin + (z + 0.5f) * GridCellSize)) - halfCell, 0.0f);
+            float distance = sqrtf(dx * dx + dz * dz);
+
+            unsigned char& tier = cellTiers_[x * GridSize + z];
+            if (distance <= nearRange) tier = INTEREST_NEAR;
+            else if (distance <= fogRange) tier = INTEREST_MID;
+            else tier = INTEREST_NONE;
+        }
+    }
+}
+
+void SnapshotClient::Receive(MemoryBuffer& message, ResourceCache* pRes, Scene* pScene, float time) {
+    unsigned id = message.ReadUInt();
+    unsigned baseId = message.ReadUInt();
+    numReceived++;
+
+    // Unreliable and unordered: drop stale snapshots and ones whose base we no longer have
+    if (id <= lastReceived) return;
+    const PODVector<QuantizedBoid>* base = history_.Find(baseId);
+    if (baseId && !base) return;
+
+    if (!ReadBoidSnapshot(message, decoded_, base)) return;
+
+    PODVector<QuantizedBoid>& stored = history_.Store(id);
+    stored = decoded_;
+    lastReceived = id;
+    if (display) Apply(decoded_, pRes, pScene, time);
+}
+
+void SnapshotClient::ReceiveJoin(MemoryBuffer& message, ResourceCache* pRes, Scene* pScene, float time) {
+    unsigned id = message.ReadUInt();
+    unsigned total = message.ReadVLE();
+    unsigned start = message.ReadVLE();
+    unsigned count = message.ReadVLE();
+    joinBytes += message.GetSize();
+
+    if (!count) {
+        if (message.ReadFloat() != ArenaHalfSize || message.ReadFloat() != ArenaHeight || message.ReadFloat() != VelocityRange)
+            URHO3D_LOGWARNING("Join snapshot quantization bounds differ from the client's");
+
+        joinId_ = id;
+        joinTotal_ = total;
+        joinBoids_.Clear();
+    } else {
+        // Chunks are reliable and ordered, so the flock grows from the front as they arrive
+        if (id != joinId_ || start != joinBoids_.Size() || start + count > joinTotal_) return;
+
+        planes_.Resize(count * JoinPlanes);
+        DecompressData(&planes_[0], message.GetData() + message.GetPosition(), planes_.Size());
+        joinBoids_.Resize(start + count);
+        UnpackPlanes(&planes_[0], count, &joinBoids_[start]);
+    }
+
+    if (display && count) Apply(joinBoids_, pRes, pScene, time);
+    if (joinBoids_.Size() < joinTotal_) return;
+
+    // Complete: regular snapshots are sent as deltas against it
+    history_.Store(id) = joinBoids_;
+    lastReceived = Max(lastReceived, id);
+    joined = true;
+}
+
+void SnapshotClient::Apply(const PODVector<QuantizedBoid>& boids, ResourceCache* pRes, Scene* pScene, float time) {
+    if (nodes_.Size() < boids.Size()) {
+        BoidPrefab small = BoidSet::CreatePrefab(pRes, false);
+        BoidPrefab big = BoidSet::CreatePrefab(pRes, true);
+
+        for (unsigned i = nodes_.Size(); i < boids.Size(); i++) {
+            const BoidPrefab& prefab = (boids[i].flags & BOID_BIG) ? big : small;
+            Node* node = pScene->CreateChild(prefab.isBig ? "BoidBig" : "BoidSmall", LOCAL);
+            node->SetScale(prefab.scale);
+            node->SetEnabled(false);
+
+            StaticModel* object = node->CreateComponent<StaticModel>(LOCAL);
+            object->SetModel(prefab.model);
+            object->SetMaterial(prefab.material);
+            object->SetCastShadows(true);
+
+            nodes_.Push(SharedPtr<Node>(node));
+        }
+        buffers_.Resize(nodes_.Size());
+    }
+
+    for (unsigned i = 0; i < boids.Size(); i++) {
+        const QuantizedBoid& boid = boids[i];
+        bool alive = (boid.flags & BOID_ALIVE) != 0;
+        bool wasAlive = i < previous_.Size() && (previous_[i].flags & BOID_ALIVE);
+
+        // Boids the server skipped this time repeat their previous value, which is not a new sample
+        if (i < previous_.Size() && SameBoid(boid, previous_[i])) continue;
+
+        if (!alive) {
+            nodes_[i]->SetEnabled(false);
+            buffers_[i].Clear();
+            continue;
+        }
+        if (!wasAlive) buffers_[i].Clear();
+
+        TransformSample sample;
+        sample.time = time;
+        sample.position = DequantizePosition(boid);
+        sample.velocity = DequantizeVelocity(boid);
+        sample.rotation = Quaternion(0.0f, DequantizeHeading(boid), 0.0f);
+        buffers_[i].Push(sample);
+    }
+
+    previous_ = boids;
+}
+
+void SnapshotClient::Update(float time) {
+    Vector3 position;
+    Quaternion rotation;
+
+    for (unsigned i = 0; i < nodes_.Size(); i++) {
+        if (!buffers_[i].Sample(time - playoutDelay, maxExtrapolation, position, rotation)) continue;
+
+        nodes_[i]->SetEnabled(true);
+        nodes_[i]->SetTransform(position, rotation);
+    }
+}
+
+const PODVector<QuantizedBoid>* SnapshotClient::GetLatest() const {
+    return history_.Find(lastReceived);
+}
+
+unsigned SnapshotClient::GetMemoryUse() const {
+    unsigned bytes = history_.GetMemoryUse() + planes_.Capacity();
+    bytes += (decoded_.Capacity() + previous_.Capacity() + joinBoids_.Capacity()) * sizeof(QuantizedBoid);
+    bytes += nodes_.Capacity() * sizeof(SharedPtr<Node>);
+    for (unsigned i = 0; i < buffers_.Size(); i++) bytes += buffers_[i].GetMemoryUse();
+    return bytes;
+}
+
+Node* SnapshotClient::Kill(unsigned index) {
+    if (index >= nodes_.Size()) return nullptr;
+
+    // Hidden now rather than when a snapshot with the alive flag cleared arrives
+    buffers_[index].Clear();
+    nodes_[index]->SetEnabled(false);
+    return nodes_[index];
+}
+
+void SnapshotClient::Clear() {
+    for (unsigned i = 0; i < nodes_.Size(); i++) nodes_[i]->Remove();
+
+    nodes_.Clear();
+    buffers_.Clear();
+    previous_.Clear();
+    lastReceived = 0;
+    numReceived = 0;
+    joined = false;
+    joinBytes = 0;
+    joinId_ = 0;
+    joinTotal_ = 0;
+    joinBoids_.Clear();
+}
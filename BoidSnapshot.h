@@ -0,0 +1,151 @@
+#pragma once
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+#include "Boids.h"
+#include "Interpolation.h"
+#include "NetStats.h"
+#include "RateControl.h"
+
+namespace Urho3D {
+    class Connection;
+}
+
+using namespace Urho3D;
+
+const static unsigned SnapshotHistory = 32; // Snapshots kept on both ends to delta against
+const static unsigned JoinChunkBoids = 4096; // Boids per join snapshot chunk, one chunk goes out per network update
+
+// Quantization bounds, positions outside are clamped
+const static float ArenaHalfSize = 100.0f;
+const static float ArenaHeight = 100.0f;
+const static float VelocityRange = 150.0f; // Boid speed is clamped to this in Boid::Update
+
+const static unsigned char BOID_ALIVE = 1;
+const static unsigned char BOID_BIG = 2;
+
+// Boid state as it goes over the wire: position in 16-bit fixed point within the arena, heading in 8 bits,
+// velocity in 8 bits per axis for the client's interpolation
+struct QuantizedBoid {
+    unsigned short x, y, z;
+    unsigned char heading;
+    unsigned char flags;
+    signed char vx, vy, vz;
+    unsigned char padding;
+};
+
+QuantizedBoid QuantizeBoid(const Vector3& position, const Vector3& velocity, float yaw, bool isBig, bool alive);
+Vector3 DequantizePosition(const QuantizedBoid& boid);
+Vector3 DequantizeVelocity(const QuantizedBoid& boid);
+float DequantizeHeading(const QuantizedBoid& boid);
+
+// Snapshots are delta-encoded against a base the receiver has acknowledged, or against all zeroes when baseId is 0.
+// The reader is called after the id and base id have been read, so the caller can look up the base first.
+void WriteBoidSnapshot(VectorBuffer& dest, unsigned id, unsigned baseId, const PODVector<QuantizedBoid>& boids, const PODVector<QuantizedBoid>* base);
+bool ReadBoidSnapshot(MemoryBuffer& source, PODVector<QuantizedBoid>& boids, const PODVector<QuantizedBoid>* base);
+
+// Join snapshots go out reliably to a connecting client instead of a full delta: a header with the quantization bounds
+// and flock size, then the flock split into chunks, each packed into byte planes and LZ4 compressed
+void WriteJoinHeader(VectorBuffer& dest, unsigned id, unsigned count);
+void WriteJoinChunk(VectorBuffer& dest, unsigned id, const PODVector<QuantizedBoid>& boids, unsigned start, unsigned count);
+
+// Ring of recent snapshots indexed by id
+class SnapshotRing {
+public:
+    PODVector<QuantizedBoid>& Store(unsigned id);
+    const PODVector<QuantizedBoid>* Find(unsigned id) const;
+    unsigned GetMemoryUse() const;
+
+private:
+    PODVector<QuantizedBoid> snapshots_[SnapshotHistory];
+    unsigned ids_[SnapshotHistory] = {};
+};
+
+// Interest tiers of a grid cell relative to a connection
+enum InterestTier {
+    INTEREST_NONE = 0,
+    INTEREST_MID,
+    INTEREST_NEAR
+};
+
+// What one connection has been sent; boids it was not sent keep their previous value
+struct SnapshotView {
+    SnapshotRing sent;
+    unsigned numNear = 0;
+    unsigned numMid = 0;
+    unsigned numSent = 0; // Boids included in the last snapshot
+    RateControl rate; // Picks the snapshot rate and detail that fit this connection's link
+    unsigned joinId = 0; // Snapshot streamed on joining, 0 before the header has gone out
+    unsigned joinSent = 0; // Boids of joinBase streamed so far
+    unsigned joinBytes = 0;
+    PODVector<QuantizedBoid> joinBase; // Kept to delta against until the client acks a regular snapshot
+    bool relay = false; // Spectator relay: the whole flock at full rate, whatever its position
+};
+
+// Server side: quantizes the flock (or takes it already quantized, on a relay) once per network update and sends
+// each connection a delta against its last ack, filtered by distance from the connection's position using the boid
+// grid. Congested connections are sent fewer mid tier boids, then none, then fewer snapshots. New connections are
+// streamed a join snapshot first, so the player can spawn while the rest of the flock arrives.
+class SnapshotServer {
+public:
+    unsigned long long bytesSent = 0;
+    float nearRange = 60.0f; // Full rate within this distance
+    float fogRange = 300.0f; // Nothing beyond this distance, matches the zone fog end
+    unsigned midInterval = 4; // Boids between the two ranges are sent every midInterval snapshots at full quality
+    NetStats* stats = nullptr;
+
+    // Methods
+    void SetState(BoidSet& boids);
+    void SetState(const PODVector<QuantizedBoid>& boids);
+    void Send(const Vector<SharedPtr<Connection> >& connections, float timeStep);
+    void RemoveConnection(Connection* connection) { views_.Erase(connection); }
+    const SnapshotView* GetView(Connection* connection) const;
+    unsigned GetMemoryUse() const;
+
+private:
+    PODVector<QuantizedBoid> current_;
+    PODVector<unsigned short> cells_; // Grid cell of each boid, x * GridSize + z
+    HashMap<Connection*, SnapshotView> views_;
+    unsigned char cellTiers_[GridSize * GridSize];
+    unsigned nextId_ = 1;
+    VectorBuffer message_;
+
+    void UpdateInterest(const Vector3& position);
+    void SendJoin(Connection* connection, SnapshotView& view);
+};
+
+// Client side: decodes snapshots into per-boid interpolation buffers and plays them out on locally created,
+// non-replicated boid nodes
+class SnapshotClient {
+public:
+    unsigned lastReceived = 0;
+    unsigned numReceived = 0; // Including stale ones, the server only wants to know what arrived
+    float playoutDelay = 0.1f; // Seconds behind the newest snapshot that boids are displayed
+    float maxExtrapolation = 0.25f; // How far past the newest snapshot a boid may be extrapolated on packet loss
+    bool display = true; // Bots only decode and ack, without creating nodes
+    bool joined = false; // All chunks of the join snapshot received
+    unsigned joinBytes = 0;
+
+    // Methods
+    void Receive(MemoryBuffer& message, ResourceCache* pRes, Scene* pScene, float time);
+    void ReceiveJoin(MemoryBuffer& message, ResourceCache* pRes, Scene* pScene, float time);
+    void Update(float time);
+    Node* Kill(unsigned index);
+    const PODVector<QuantizedBoid>* GetLatest() const; // Newest decoded flock, for relaying
+    unsigned GetMemoryUse() const; // Not counting the boid nodes, they belong to the scene
+    void Clear();
+
+private:
+    SnapshotRing history_;
+    PODVector<QuantizedBoid> decoded_;
+    PODVector<QuantizedBoid> previous_;
+    Vector<SharedPtr<Node> > nodes_;
+    Vector<InterpolationBuffer> buffers_;
+    unsigned joinId_ = 0;
+    unsigned joinTotal_ = 0;
+    PODVector<QuantizedBoid> joinBoids_;
+    PODVector<unsigned char> planes_;
+
+    void Apply(const PODVector<QuantizedBoid>& boids, ResourceCache* pRes, Scene* pScene, float time);
+};
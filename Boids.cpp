@@ -1,5 +1,7 @@
 #include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/Timer.h>
 #include <Urho3D/Graphics/AnimationController.h>
+#include <Urho3D/IO/Log.h>
 #include <Urho3D/IO/MemoryBuffer.h>
 #include <Urho3D/Network/Connection.h>
 #include <Urho3D/Network/Network.h>
@@ -10,6 +12,7 @@
 #include <Urho3D/Scene/Scene.h>
 #include <Urho3D/Scene/SceneEvents.h>
 #include <cmath>
+#include <cstring>
 
 #include "Boids.h"
 
@@ -26,37 +29,35 @@ Boid::Boid() {
     pObject = nullptr;
     pRigidBody = nullptr;
     pCollisionShape = nullptr;
+    gridX = gridZ = 0;
+    dormantStart = 0.0f;
 }
 
-void Boid::Initialise(ResourceCache *pRes, Scene *pScene, bool isBig) {
-    this->isBig = isBig;
+void Boid::Initialise(Scene *pScene, const BoidPrefab& prefab) {
+    static const String nameBig("BoidBig");
+    static const String nameSmall("BoidSmall");
 
-    if (isBig) pNode = pScene->CreateChild("BoidBig");
-    else pNode = pScene->CreateChild("BoidSmall");
-    pNode->SetPosition(Vector3(Random(180.0f) - 90.0f, Random(70.0f) + 15.0f, Random(180.0f) - 90.0f));
-
-    pObject = pNode->CreateComponent<StaticModel>();
+    this->isBig = prefab.isBig;
 
-    if (isBig) {
-        pObject->SetModel(pRes->GetResource<Model>("Models/TropicalFish01.mdl"));
-        pNode->SetScale(1.0);
-    } else {
-        pObject->SetModel(pRes->GetResource<Model>("Models/TropicalFish01.mdl"));
-        pNode->SetScale(1.0);
-    }
+    // Boids are not scene-replicated, clients receive them through boid snapshots
+    pNode = pScene->CreateChild(isBig ? nameBig : nameSmall, LOCAL);
+    pNode->SetPosition(Vector3(Random(180.0f) - 90.0f, Random(70.0f) + 15.0f, Random(180.0f) - 90.0f));
+    pNode->SetScale(prefab.scale);
 
-    pObject->SetMaterial(pRes->GetResource<Material>("Materials/Red-Scales.xml"));
+    pObject = pNode->CreateComponent<StaticModel>(LOCAL);
+    pObject->SetModel(prefab.model);
+    pObject->SetMaterial(prefab.material);
     pObject->SetCastShadows(true);
 
-    pRigidBody = pNode->CreateComponent<RigidBody>();
+    pRigidBody = pNode->CreateComponent<RigidBody>(LOCAL);
     pRigidBody->SetUseGravity(false);
     pRigidBody->SetMass(1.0f);
     pRigidBody->SetCollisionLayer(2);
 
-    pCollisionShape = pNode->CreateComponent<CollisionShape>();
+    pCollisionShape = pNode->CreateComponent<CollisionShape>(LOCAL);
     pCollisionShape->SetBox(pNode->GetScale());
 }
-void Boid::ComputeForce(Boid *pBoidList, Vector<Vector3> playerPositions, Vector<int> neighbours) {
+void Boid::ComputeForce(Boid *pBoidList, const Vector<Vector3>& playerPositions, const int* neighbours, unsigned numNeighbours) {
     force = Vector3(0,0,0); // Reset total force
     Vector3 fs, fc, fa; // Separation, Cohesion and Alignment forces
 
@@ -64,7 +65,7 @@ void Boid::ComputeForce(Boid *pBoidList, Vector<Vector3> playerPositions, Vector
     Vector3 pMean, vMean; // Position and Velocity means
     int pN = 0, vN = 0; // Neighbour count for Cohesion and Alignment calculations
 
-    for (Vector<Vector3>::Iterator p = playerPositions.Begin(); p < playerPositions.End(); p++) {
+    for (Vector<Vector3>::ConstIterator p = playerPositions.Begin(); p < playerPositions.End(); p++) {
         Vector3 pDelta = pos - *p;
 
         if (pDelta.Length() < separationRange) {
@@ -72,8 +73,8 @@ void Boid::ComputeForce(Boid *pBoidList, Vector<Vector3> playerPositions, Vector
         }
     }
 
-    for (Vector<int>::Iterator n = neighbours.Begin(); n != neighbours.End(); ++n) {
-        int i = *n.ptr_;
+    for (unsigned n = 0; n < numNeighbours; ++n) {
+        int i = neighbours[n];
 
 
         if (this == &pBoidList[i] || !pNode->IsEnabled() || !pBoidList[i].pNode->IsEnabled()) continue;
@@ -138,62 +139,260 @@ void Boid::Update(float tm) {
     pRigidBody->SetRotation(Quaternion(0.0, 180 - (90 + atan2(vel.z_, vel.x_) * 180 / 3.14159265), 0.0));
 }
 
-void BoidSet::Initialise(ResourceCache *pRes, Scene *pScene) {
+void BoidSet::Initialise(ResourceCache *pRes, Scene *pScene, int numSmall, int numBig) {
     boidGrid.Resize(GridSize);
     for (int i = 0; i < GridSize; i++) {
         boidGrid[i].Resize(GridSize);
     }
 
-    for (int i = 0; i < NumBoids; i++) {
-        if (i < NumSmall) boidList[i].Initialise(pRes, pScene, false);
-        else boidList[i].Initialise(pRes, pScene, true);
-    }
+    boidList.Clear();
+    boidList.Reserve(numSmall + numBig);
+
+    Spawn(pScene, CreatePrefab(pRes, false), numSmall);
+    Spawn(pScene, CreatePrefab(pRes, true), numBig);
 
     UpdateGrid();
 }
 
-void BoidSet::Update(float tm, Vector<Vector3> playerPositions) {
-    for (int i = 0; i < NumBoids; i++) {
-        if (boidList[i].pNode != NULL) {
+BoidPrefab BoidSet::CreatePrefab(ResourceCache *pRes, bool isBig) {
+    BoidPrefab prefab;
+    prefab.model = pRes->GetResource<Model>("Models/TropicalFish01.mdl");
+    prefab.material = pRes->GetResource<Material>("Materials/Red-Scales.xml");
+    prefab.isBig = isBig;
+    prefab.scale = 1.0f;
+    return prefab;
+}
 
-            Vector<int> neighbours = boidGrid[boidList[i].gridX][boidList[i].gridZ];
+void BoidSet::Spawn(Scene *pScene, const BoidPrefab& prefab, int count) {
+    HiresTimer timer;
 
-            if (boidList[i].gridX + 1 < 20 && boidList[i].gridZ + 1 < 20) neighbours += boidGrid[boidList[i].gridX + 1][boidList[i].gridZ + 1];
-            if (boidList[i].gridX - 1 > 0 && boidList[i].gridZ + 1 < 20) neighbours += boidGrid[boidList[i].gridX - 1][boidList[i].gridZ + 1];
-            if (boidList[i].gridX + 1 < 20 && boidList[i].gridZ - 1 > 0) neighbours += boidGrid[boidList[i].gridX + 1][boidList[i].gridZ - 1];
-            if (boidList[i].gridX - 1 > 0 && boidList[i].gridZ - 1 > 0) neighbours += boidGrid[boidList[i].gridX - 1][boidList[i].gridZ - 1];
-            if (boidList[i].gridX + 1 < 20) neighbours += boidGrid[boidList[i].gridX + 1][boidList[i].gridZ];
-            if (boidList[i].gridX - 1 > 0) neighbours += boidGrid[boidList[i].gridX - 1][boidList[i].gridZ];
-            if (boidList[i].gridZ + 1 < 20) neighbours += boidGrid[boidList[i].gridX][boidList[i].gridZ + 1];
-            if (boidList[i].gridZ - 1 > 0) neighbours += boidGrid[boidList[i].gridX][boidList[i].gridZ - 1];
+    // Boids are constructed in place so the list never reallocates mid-batch
+    unsigned first = boidList.Size();
+    if (boidList.Capacity() < first + count) boidList.Reserve(first + count);
+    boidList.Resize(first + count);
 
-            boidList[i].ComputeForce(&boidList[0], playerPositions, neighbours);
-            boidList[i].Update(tm);
-        }
+    for (unsigned i = first; i < boidList.Size(); i++) {
+        boidList[i].Initialise(pScene, prefab);
+    }
+
+    long long elapsed = timer.GetUSec(false);
+    URHO3D_LOGINFOF("Spawned %d %s boids in %.2f ms (%.2f us per boid)", count, prefab.isBig ? "big" : "small",
+        elapsed / 1000.0f, count > 0 ? (float)elapsed / count : 0.0f);
+}
+
+void BoidSet::Clear() {
+    for (unsigned i = 0; i < boidList.Size(); i++) {
+        if (boidList[i].pNode) boidList[i].pNode->Remove();
     }
 
+    boidList.Clear();
+}
+
+void BoidSet::Update(float tm, const Vector<Vector3>& playerPositions, ScratchAllocator& scratch) {
+    ComputeForces(playerPositions, scratch);
+    Integrate(tm);
     UpdateGrid();
 }
 
+void BoidSet::ComputeForces(const Vector<Vector3>& playerPositions, ScratchAllocator& scratch) {
+    // Reads positions and velocities only, so it can run off the main thread
+    for (unsigned i = 0; i < boidList.Size(); i++) {
+        if (boidList[i].pNode != NULL && IsActive(boidList[i])) {
+            int x = boidList[i].gridX;
+            int z = boidList[i].gridZ;
+            const Vector<int>* cells[9];
+            unsigned numCells = 0;
+
+            cells[numCells++] = &boidGrid[x][z];
+            if (x + 1 < 20 && z + 1 < 20) cells[numCells++] = &boidGrid[x + 1][z + 1];
+            if (x - 1 > 0 && z + 1 < 20) cells[numCells++] = &boidGrid[x - 1][z + 1];
+            if (x + 1 < 20 && z - 1 > 0) cells[numCells++] = &boidGrid[x + 1][z - 1];
+            if (x - 1 > 0 && z - 1 > 0) cells[numCells++] = &boidGrid[x - 1][z - 1];
+            if (x + 1 < 20) cells[numCells++] = &boidGrid[x + 1][z];
+            if (x - 1 > 0) cells[numCells++] = &boidGrid[x - 1][z];
+            if (z + 1 < 20) cells[numCells++] = &boidGrid[x][z + 1];
+            if (z - 1 > 0) cells[numCells++] = &boidGrid[x][z - 1];
+
+            // The neighbour list is scratch, given back before the next boid
+            ScratchMark mark = scratch.GetMark();
+            unsigned numNeighbours = 0;
+            for (unsigned j = 0; j < numCells; j++) numNeighbours += cells[j]->Size();
+
+            int* neighbours = scratch.Allocate<int>(numNeighbours);
+            int* next = neighbours;
+            for (unsigned j = 0; j < numCells; j++) {
+                if (cells[j]->Empty()) continue;
+                memcpy(next, cells[j]->Buffer(), cells[j]->Size() * sizeof(int));
+                next += cells[j]->Size();
+            }
+
+            boidList[i].ComputeForce(&boidList[0], playerPositions, neighbours, numNeighbours);
+            scratch.Rewind(mark);
+        }
+    }
+}
+
+void BoidSet::Integrate(float tm) {
+    for (unsigned i = 0; i < boidList.Size(); i++) {
+        if (boidList[i].pNode != NULL && IsActive(boidList[i])) boidList[i].Update(tm);
+    }
+}
+
 void BoidSet::UpdateGrid() {
+    // Dormant boids don't move, so their cells are left as they are
     for (int i = 0; i < GridSize; i++) {
         for (int j = 0; j < GridSize; j++) {
-            boidGrid[i][j].Clear();
+            if (regions[i / RegionCells][j / RegionCells].active) boidGrid[i][j].Clear();
         }
     }
 
-    for (int i = 0; i < NumBoids; i++) {
-        Vector3 pos = boidList[i].pRigidBody->GetPosition();
-        int x = (pos.x_ + 100.0) / 10.0;
-        int z = (pos.z_ + 100.0) / 10.0;
+    for (unsigned i = 0; i < boidList.Size(); i++) {
+        if (!IsActive(boidList[i])) continue;
 
-        if (x < 0) x = 0;
-        else if (x > GridSize - 1) x = GridSize - 1;
-        if (z < 0) z = 0;
-        else if (z > GridSize - 1) z = GridSize - 1;
+        int x, z;
+        GetCell(boidList[i].pRigidBody->GetPosition(), x, z);
+
+        // Flown into a dormant region, it sleeps with the rest of the region from here on
+        if (!regions[x / RegionCells][z / RegionCells].active) {
+            Sleep(i, x, z);
+            continue;
+        }
 
         boidList[i].gridX = x;
         boidList[i].gridZ = z;
         boidGrid[x][z].Push(i);
     }
 }
+
+void BoidSet::GetCell(const Vector3& position, int& x, int& z) {
+    x = (position.x_ + GridSize * GridCellSize * 0.5f) / GridCellSize;
+    z = (position.z_ + GridSize * GridCellSize * 0.5f) / GridCellSize;
+
+    if (x < 0) x = 0;
+    else if (x > GridSize - 1) x = GridSize - 1;
+    if (z < 0) z = 0;
+    else if (z > GridSize - 1) z = GridSize - 1;
+}
+
+void BoidSet::Sleep(unsigned index, int x, int z) {
+    // Dormant cells are not rebuilt by UpdateGrid, so the boid is added to its new one here; the caller has taken it
+    // out of its old one
+    Boid& boid = boidList[index];
+    boid.gridX = x;
+    boid.gridZ = z;
+    boid.dormantStart = regions[x / RegionCells][z / RegionCells].dormantTime;
+    boid.pRigidBody->SetEnabled(false);
+    boidGrid[x][z].Push(index);
+}
+
+void BoidSet::UpdateRegions(const Vector<Vector3>& wakePositions, float timeStep) {
+    float regionSize = RegionCells * GridCellSize;
+    float origin = -GridSize * GridCellSize * 0.5f;
+    float radiusSquared = wakeRadius * wakeRadius;
+
+    numActiveRegions = 0;
+    for (int x = 0; x < NumRegions; x++) {
+        for (int z = 0; z < NumRegions; z++) {
+            // Distance in the horizontal plane from each position to the nearest point of the region
+            float minX = origin + x * regionSize;
+            float minZ = origin + z * regionSize;
+            bool active = wakeRadius <= 0.0f;
+
+            for (unsigned i = 0; i < wakePositions.Size() && !active; i++) {
+                float dx = Max(Max(minX - wakePositions[i].x_, wakePositions[i].x_ - minX - regionSize), 0.0f);
+                float dz = Max(Max(minZ - wakePositions[i].z_, wakePositions[i].z_ - minZ - regionSize), 0.0f);
+                active = dx * dx + dz * dz <= radiusSquared;
+            }
+
+            if (active != regions[x][z].active) SetRegionActive(x, z, active);
+            if (active) numActiveRegions++;
+            else regions[x][z].dormantTime += timeStep;
+        }
+    }
+}
+
+void BoidSet::SetRegionActive(int x, int z, bool active) {
+    Region& region = regions[x][z];
+
+    for (unsigned i = 0; i < boidList.Size(); i++) {
+        Boid& boid = boidList[i];
+        if (!boid.pNode || boid.gridX / RegionCells != x || boid.gridZ / RegionCells != z) continue;
+
+        // A cheap stand-in for the time asleep: carry on along the last velocity, within the flocking bounds
+        float catchUp = active ? Min(region.dormantTime - boid.dormantStart, MaxCatchUp) : 0.0f;
+        if (catchUp > 0.0f) {
+            Vector3 position = boid.pRigidBody->GetPosition() + boid.pRigidBody->GetLinearVelocity() * catchUp;
+            position.x_ = Clamp(position.x_, -90.0f, 90.0f);
+            position.y_ = Clamp(position.y_, 10.0f, 40.0f);
+            position.z_ = Clamp(position.z_, -90.0f, 90.0f);
+            boid.pRigidBody->SetPosition(position);
+
+            // Caught up into another region that is still asleep, it stays asleep there
+            int cellX, cellZ;
+            GetCell(position, cellX, cellZ);
+            const Region& target = regions[cellX / RegionCells][cellZ / RegionCells];
+            if (&target != &region && !target.active) {
+                boidGrid[boid.gridX][boid.gridZ].Remove(i);
+                Sleep(i, cellX, cellZ);
+                continue;
+            }
+        }
+
+        boid.dormantStart = 0.0f;
+        boid.pRigidBody->SetEnabled(active);
+    }
+
+    region.active = active;
+    region.dormantTime = 0.0f;
+}
+
+unsigned BoidSet::GetMemoryUse() const {
+    unsigned bytes = boidList.Capacity() * sizeof(Boid);
+    for (unsigned x = 0; x < boidGrid.Size(); x++) {
+        for (unsigned z = 0; z < boidGrid[x].Size(); z++) bytes += sizeof(Vector<int>) + boidGrid[x][z].Capacity() * sizeof(int);
+    }
+    return bytes;
+}
+
+bool BoidSet::SweepSphere(const Vector3& start, const Vector3& direction, float radius, float maxDistance, BoidHit& hit) const {
+    if (boidGrid.Empty()) return false;
+
+    Vector3 dir = direction.Normalized();
+    Vector3 end = start + dir * maxDistance;
+    float reach = radius + BoidRadius;
+    float reachSquared = reach * reach;
+
+    // Only the cells the swept sphere's bounds overlap, widened by how far boids may have moved since UpdateGrid
+    float extent = reach + GridSlack;
+    float origin = GridSize * GridCellSize * 0.5f;
+    int minX = Clamp((int)((Min(start.x_, end.x_) - extent + origin) / GridCellSize), 0, GridSize - 1);
+    int maxX = Clamp((int)((Max(start.x_, end.x_) + extent + origin) / GridCellSize), 0, GridSize - 1);
+    int minZ = Clamp((int)((Min(start.z_, end.z_) - extent + origin) / GridCellSize), 0, GridSize - 1);
+    int maxZ = Clamp((int)((Max(start.z_, end.z_) + extent + origin) / GridCellSize), 0, GridSize - 1);
+
+    bool found = false;
+    hit.distance = M_INFINITY;
+
+    for (int x = minX; x <= maxX; x++) {
+        for (int z = minZ; z <= maxZ; z++) {
+            const Vector<int>& cell = boidGrid[x][z];
+
+            for (unsigned i = 0; i < cell.Size(); i++) {
+                const Boid& boid = boidList[cell[i]];
+                if (!boid.pNode->IsEnabled()) continue;
+
+                // Closest point on the sweep to the boid centre, the sphere touches it when within reach
+                Vector3 offset = boid.pRigidBody->GetPosition() - start;
+                float along = Clamp(offset.DotProduct(dir), 0.0f, maxDistance);
+                if ((offset - dir * along).LengthSquared() > reachSquared || along >= hit.distance) continue;
+
+                hit.index = cell[i];
+                hit.isBig = boid.isBig;
+                hit.distance = along;
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
@@ -21,6 +21,7 @@
 #include <Urho3D/Scene/Scene.h>
 
 #include "Player.h"
+#include "ScratchAllocator.h"
 
 namespace Urho3D
 {
@@ -34,9 +35,23 @@ namespace Urho3D
 using namespace Urho3D;
 
 const static int GridSize = 20;
+const static float GridCellSize = 10.0f; // GridSize cells of this size span the 200x200 arena
 const static int NumSmall = 100;
 const static int NumMedium = 100;
 const static int NumBoids = NumSmall + NumMedium;
+const static float BoidRadius = 0.5f; // Bounding sphere of the unit box collision shape, near enough
+const static float GridSlack = 2.5f; // Furthest a boid moves in one 60 Hz step at full speed, since the grid was built
+const static int RegionCells = 5; // Grid cells along each side of an activation region
+const static int NumRegions = GridSize / RegionCells; // Regions along each side of the arena
+const static float MaxCatchUp = 1.0f; // Seconds of dormancy a waking region's boids are advanced by at most
+
+// Resources and settings shared by every boid of a species, resolved once per spawn batch
+struct BoidPrefab {
+    Model* model;
+    Material* material;
+    bool isBig;
+    float scale;
+};
 
 class Boid {
     static float separationRange; // Separation Range
@@ -55,21 +70,54 @@ public:
     CollisionShape* pCollisionShape;
     bool isBig;
     int gridX, gridZ;
+    float dormantStart; // Region::dormantTime when the boid went to sleep, it may join a region already asleep
 
     // Methods
     Boid();
-    void Initialise(ResourceCache *pRes, Scene *pScene, bool isBig);
+    void Initialise(Scene *pScene, const BoidPrefab& prefab);
     void Update(float tm);
-    void ComputeForce(Boid *b, Vector<Vector3> playerPositions, Vector<int> neighbours);
+    void ComputeForce(Boid *b, const Vector<Vector3>& playerPositions, const int* neighbours, unsigned numNeighbours);
+};
+
+// Block of grid cells whose boids are simulated only while a player is near. Dormant boids keep their state and
+// have their rigid bodies taken out of the physics world, including boids that fly or are caught up into the region
+// while it sleeps.
+struct Region {
+    bool active = true;
+    float dormantTime = 0.0f;
+};
+
+// Closest boid hit by a swept sphere
+struct BoidHit {
+    unsigned index;
+    bool isBig;
+    float distance;
 };
 
 class BoidSet {
 public:
-    Boid boidList[NumBoids];
+    Vector<Boid> boidList;
     Vector<Vector<Vector<int>>> boidGrid;
+    Region regions[NumRegions][NumRegions];
+    float wakeRadius = 0.0f; // Regions within this distance of a player are active, all of them when 0
+    unsigned numActiveRegions = NumRegions * NumRegions;
 
     BoidSet() {};
-    void Initialise(ResourceCache *pRes, Scene *pScene);
-    void Update(float tm, Vector<Vector3> playerPositions);
+    void Initialise(ResourceCache *pRes, Scene *pScene, int numSmall = NumSmall, int numBig = NumMedium);
+    static BoidPrefab CreatePrefab(ResourceCache *pRes, bool isBig);
+    void Spawn(Scene *pScene, const BoidPrefab& prefab, int count);
+    void Clear();
+    void Update(float tm, const Vector<Vector3>& playerPositions, ScratchAllocator& scratch);
+    void ComputeForces(const Vector<Vector3>& playerPositions, ScratchAllocator& scratch);
+    void Integrate(float tm);
     void UpdateGrid();
+    void UpdateRegions(const Vector<Vector3>& wakePositions, float timeStep);
+    bool IsActive(const Boid& boid) const { return regions[boid.gridX / RegionCells][boid.gridZ / RegionCells].active; }
+    bool SweepSphere(const Vector3& start, const Vector3& direction, float radius, float maxDistance, BoidHit& hit) const;
+    unsigned GetMemoryUse() const; // The list and grid, the boids' nodes belong to the scene
+
+private:
+    static void GetCell(const Vector3& position, int& x, int& z);
+    void Sleep(unsigned index, int x, int z);
+    void SetRegionActive(int x, int z, bool active);
 };
@@ -0,0 +1,62 @@
+# Offline texture pipeline: converts the PBR JPGs in bin/Autoload/LargeData into block-compressed DDS files with full
+# mip chains, and writes matching material XMLs that reference them, into ${CMAKE_BINARY_DIR}/bin/CompressedData.
+#
+#  Albedo, Emissive    -> BC1 (DXT1)
+#  Properties, PBR     -> BC3 (DXT5)
+#  Normal              -> BC3n (DXT5nm, X in alpha and Y in green, decoded by the PACKEDNORMAL shader path)
+#
+# Urho3D's DDS loader has no BC5 format, so normal maps use the swizzled BC3 layout instead.
+# Requires nvcompress from the NVIDIA Texture Tools; the target is skipped with a warning when it cannot be found.
+
+macro (setup_texture_compression)
+    find_program (NVCOMPRESS nvcompress DOC "Path to nvcompress (NVIDIA Texture Tools)")
+    mark_as_advanced (NVCOMPRESS)
+
+    set (TEXTURE_SOURCE_DIR ${CMAKE_SOURCE_DIR}/bin/Autoload/LargeData)
+    set (TEXTURE_OUTPUT_DIR ${CMAKE_BINARY_DIR}/bin/CompressedData)
+
+    if (NOT NVCOMPRESS)
+        message (WARNING "Could not find nvcompress, the 'textures' target will not be available.")
+    else ()
+        unset (COMPRESSED_TEXTURES)
+        file (GLOB_RECURSE SOURCE_TEXTURES RELATIVE ${TEXTURE_SOURCE_DIR} ${TEXTURE_SOURCE_DIR}/Textures/PBR/*.jpg)
+        foreach (TEXTURE ${SOURCE_TEXTURES})
+            get_filename_component (NAME ${TEXTURE} NAME_WE)
+            get_filename_component (DIR ${TEXTURE} PATH)
+            if (NAME STREQUAL Normal)
+                set (FORMAT -bc3n -normal)
+            elseif (NAME STREQUAL Properties OR NAME STREQUAL PBR)
+                set (FORMAT -bc3 -color)
+            else ()
+                set (FORMAT -bc1 -color)
+            endif ()
+            set (OUTPUT ${TEXTURE_OUTPUT_DIR}/${DIR}/${NAME}.dds)
+            add_custom_command (OUTPUT ${OUTPUT}
+                COMMAND ${CMAKE_COMMAND} -E make_directory ${TEXTURE_OUTPUT_DIR}/${DIR}
+                COMMAND ${NVCOMPRESS} -silent ${FORMAT} ${TEXTURE_SOURCE_DIR}/${TEXTURE} ${OUTPUT}
+                DEPENDS ${TEXTURE_SOURCE_DIR}/${TEXTURE}
+                COMMENT "Compressing ${TEXTURE}")
+            list (APPEND COMPRESSED_TEXTURES ${OUTPUT})
+            # Texture parameter files (sRGB etc.) are looked up by base name so they apply to the DDS unchanged
+            if (EXISTS ${TEXTURE_SOURCE_DIR}/${DIR}/${NAME}.xml)
+                add_custom_command (OUTPUT ${TEXTURE_OUTPUT_DIR}/${DIR}/${NAME}.xml
+                    COMMAND ${CMAKE_COMMAND} -E copy_if_different ${TEXTURE_SOURCE_DIR}/${DIR}/${NAME}.xml ${TEXTURE_OUTPUT_DIR}/${DIR}/${NAME}.xml
+                    DEPENDS ${TEXTURE_SOURCE_DIR}/${DIR}/${NAME}.xml)
+                list (APPEND COMPRESSED_TEXTURES ${TEXTURE_OUTPUT_DIR}/${DIR}/${NAME}.xml)
+            endif ()
+        endforeach ()
+
+        unset (PATCHED_MATERIALS)
+        file (GLOB SOURCE_MATERIALS RELATIVE ${TEXTURE_SOURCE_DIR} ${TEXTURE_SOURCE_DIR}/Materials/PBR/*.xml)
+        foreach (MATERIAL ${SOURCE_MATERIALS})
+            add_custom_command (OUTPUT ${TEXTURE_OUTPUT_DIR}/${MATERIAL}
+                COMMAND ${CMAKE_COMMAND} -DINPUT=${TEXTURE_SOURCE_DIR}/${MATERIAL} -DOUTPUT=${TEXTURE_OUTPUT_DIR}/${MATERIAL}
+                    -P ${CMAKE_SOURCE_DIR}/CMake/Modules/PatchMaterialTextures.cmake
+                DEPENDS ${TEXTURE_SOURCE_DIR}/${MATERIAL} ${CMAKE_SOURCE_DIR}/CMake/Modules/PatchMaterialTextures.cmake)
+            list (APPEND PATCHED_MATERIALS ${TEXTURE_OUTPUT_DIR}/${MATERIAL})
+        endforeach ()
+
+        add_custom_target (textures DEPENDS ${COMPRESSED_TEXTURES} ${PATCHED_MATERIALS}
+            COMMENT "Converting PBR textures to compressed DDS")
+    endif ()
+endmacro ()
@@ -0,0 +1,32 @@
+# Resource packages for the memory-mapped loader ('packages' target). Each resource directory is split by file size:
+#  <Name>-small.pak - uncompressed, files up to PACKAGE_SMALL_LIMIT bytes, read in place from the mapping
+#  <Name>-large.pak - LZ4 compressed, larger files, decompressed when requested
+# CoreData and Data packages are written to ${CMAKE_BINARY_DIR}/bin and the Autoload ones to bin/Autoload, start with -packages to use them.
+
+macro (setup_resource_packages)
+    find_Urho3D_tool (PACKAGE_TOOL PackageTool
+        HINTS ${CMAKE_BINARY_DIR}/bin/tool ${URHO3D_HOME}/bin/tool
+        DOC "Path to PackageTool" MSG_MODE WARNING)
+    set (PACKAGE_SMALL_LIMIT 65536 CACHE STRING "Largest file in bytes stored uncompressed in the resource packages")
+
+    unset (RESOURCE_PACKAGES)
+    foreach (DIR CoreData Data Autoload/LargeData)
+        get_filename_component (NAME ${DIR} NAME)
+        get_filename_component (PARENT ${DIR} PATH)
+        set (SOURCE ${CMAKE_SOURCE_DIR}/bin/${DIR})
+        set (STAGING ${CMAKE_BINARY_DIR}/PackageStaging/${NAME})
+        set (OUTPUT ${CMAKE_BINARY_DIR}/bin/${PARENT})
+        file (GLOB_RECURSE FILES ${SOURCE}/*)
+        add_custom_command (OUTPUT ${OUTPUT}/${NAME}-small.pak ${OUTPUT}/${NAME}-large.pak
+            COMMAND ${CMAKE_COMMAND} -DSOURCE=${SOURCE} -DSTAGING=${STAGING} -DLIMIT=${PACKAGE_SMALL_LIMIT}
+                -P ${CMAKE_SOURCE_DIR}/CMake/Modules/StagePackageFiles.cmake
+            COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTPUT}
+            COMMAND ${PACKAGE_TOOL} ${STAGING}/small ${OUTPUT}/${NAME}-small.pak -q
+            COMMAND ${PACKAGE_TOOL} ${STAGING}/large ${OUTPUT}/${NAME}-large.pak -c -q
+            DEPENDS ${FILES} ${CMAKE_SOURCE_DIR}/CMake/Modules/StagePackageFiles.cmake
+            COMMENT "Packaging ${DIR}")
+        list (APPEND RESOURCE_PACKAGES ${OUTPUT}/${NAME}-small.pak ${OUTPUT}/${NAME}-large.pak)
+    endforeach ()
+
+    add_custom_target (packages DEPENDS ${RESOURCE_PACKAGES} COMMENT "Building memory-mapped resource packages")
+endmacro ()
@@ -0,0 +1,12 @@
+# Rewrite a material XML to reference the compressed DDS textures produced by the 'textures' target
+# Usage: cmake -DINPUT=<material.xml> -DOUTPUT=<material.xml> -P PatchMaterialTextures.cmake
+
+file (READ ${INPUT} CONTENT)
+string (REGEX REPLACE "\\.jpg\"" ".dds\"" CONTENT "${CONTENT}")
+# Normal maps are stored as DXT5nm, so the shader has to reconstruct Z from the packed X/Y channels
+if (CONTENT MATCHES "unit=\"normal\"" AND NOT CONTENT MATCHES "PACKEDNORMAL")
+    string (REGEX REPLACE "(<technique[^>]*/>)" "\\1\n\t<shader psdefines=\"PACKEDNORMAL\" />" CONTENT "${CONTENT}")
+endif ()
+get_filename_component (DIR ${OUTPUT} PATH)
+file (MAKE_DIRECTORY ${DIR})
+file (WRITE ${OUTPUT} "${CONTENT}")
@@ -0,0 +1,21 @@
+# Split a resource directory into small and large files for packaging
+# Usage: cmake -DSOURCE=<dir> -DSTAGING=<dir> -DLIMIT=<bytes> -P StagePackageFiles.cmake
+
+file (REMOVE_RECURSE ${STAGING})
+file (MAKE_DIRECTORY ${STAGING}/small ${STAGING}/large)
+math (EXPR READ_LIMIT "${LIMIT} + 1")
+
+file (GLOB_RECURSE FILES RELATIVE ${SOURCE} ${SOURCE}/*)
+foreach (FILE ${FILES})
+    # Reading one byte past the limit tells the two apart without needing file (SIZE)
+    file (READ ${SOURCE}/${FILE} CONTENT LIMIT ${READ_LIMIT} HEX)
+    string (LENGTH "${CONTENT}" LENGTH)
+    math (EXPR LENGTH "${LENGTH} / 2")
+    if (LENGTH GREATER LIMIT)
+        set (BUCKET large)
+    else ()
+        set (BUCKET small)
+    endif ()
+    get_filename_component (DIR ${FILE} PATH)
+    file (COPY ${SOURCE}/${FILE} DESTINATION ${STAGING}/${BUCKET}/${DIR})
+endforeach ()
@@ -0,0 +1,164 @@
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Math/Random.h>
+#include <Urho3D/Network/Connection.h>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "Checkpoint.h"
+#include "MappedFile.h"
+#include "Messages.h"
+
+String CreatePlayerToken() {
+    // Not from Urho3D's Random, which bots started with the same -seed would share
+    std::random_device device;
+    return ToString("%08x%08x%08x%08x", device(), device(), device(), device());
+}
+
+void CheckpointWriter::ThreadFunction() {
+    // Write to a temporary file first so a crash mid-write keeps the previous checkpoint intact
+    String tempPath = path + ".tmp";
+    FILE* file = fopen(tempPath.CString(), "wb");
+
+    if (file) {
+        bool written = fwrite(&buffer[0], 1, buffer.Size(), file) == buffer.Size();
+        written = fclose(file) == 0 && written;
+
+        if (written) {
+            remove(path.CString());
+            rename(tempPath.CString(), path.CString());
+        }
+    }
+
+    finished = true;
+}
+
+Checkpoint::Checkpoint(Context* context) : Object(context) {}
+
+Checkpoint::~Checkpoint() {
+    writer_.Stop();
+}
+
+void Checkpoint::Update(float timeStep, BoidSet& boids, HashMap<Connection*, Player*>& players) {
+    if (!capturing_) {
+        timer_ += timeStep;
+        if (timer_ < interval || !writer_.finished) return;
+
+        writer_.Stop();
+        writer_.path = path;
+        writer_.buffer.Resize(sizeof(CheckpointHeader) + boids.boidList.Size() * sizeof(BoidRecord));
+        timer_ = 0.0f;
+        captured_ = 0;
+        capturing_ = true;
+    }
+
+    unsigned numBoids = (writer_.buffer.Size() - sizeof(CheckpointHeader)) / sizeof(BoidRecord);
+    BoidRecord* records = reinterpret_cast<BoidRecord*>(&writer_.buffer[sizeof(CheckpointHeader)]);
+    unsigned end = Min(Min(captured_ + sliceSize, numBoids), boids.boidList.Size());
+
+    for (; captured_ < end; captured_++) {
+        Boid& boid = boids.boidList[captured_];
+        BoidRecord& record = records[captured_];
+
+        record.position = boid.pRigidBody->GetPosition();
+        record.velocity = boid.pRigidBody->GetLinearVelocity();
+        record.isBig = boid.isBig ? 1 : 0;
+        record.alive = boid.pNode->IsEnabled() ? 1 : 0;
+        record.padding = 0;
+    }
+
+    if (captured_ < numBoids && captured_ < boids.boidList.Size()) return;
+
+    // All boids captured, add the scores and hand the buffer to the writer thread
+    unsigned scoreOffset = writer_.buffer.Size();
+    writer_.buffer.Resize(scoreOffset + players.Size() * sizeof(ScoreRecord));
+    ScoreRecord* scores = reinterpret_cast<ScoreRecord*>(&writer_.buffer[scoreOffset]);
+
+    unsigned numScores = 0;
+    for (HashMap<Connection*, Player*>::Iterator i = players.Begin(); i != players.End(); ++i) {
+        if (!i->second_) continue;
+
+        ScoreRecord& record = scores[numScores++];
+        memset(record.player, 0, sizeof(record.player));
+        strncpy(record.player, GetPlayerKey(i->first_).CString(), sizeof(record.player) - 1);
+        record.score = i->second_->score;
+    }
+    writer_.buffer.Resize(scoreOffset + numScores * sizeof(ScoreRecord));
+
+    CheckpointHeader* header = reinterpret_cast<CheckpointHeader*>(&writer_.buffer[0]);
+    memcpy(header->id, "BCKP", 4);
+    header->version = CheckpointVersion;
+    header->randomSeed = GetRandomSeed();
+    header->numBoids = captured_;
+    header->numScores = numScores;
+
+    capturing_ = false;
+    writer_.finished = false;
+    writer_.Run();
+}
+
+bool Checkpoint::Restore(ResourceCache* pRes, Scene* pScene, BoidSet& boids) {
+    HiresTimer timer;
+    MappedFile file;
+
+    if (!file.Open(path) || file.size < sizeof(CheckpointHeader)) return false;
+
+    const CheckpointHeader* header = reinterpret_cast<const CheckpointHeader*>(file.data);
+    if (memcmp(header->id, "BCKP", 4) != 0 || header->version != CheckpointVersion ||
+        file.size != sizeof(CheckpointHeader) + header->numBoids * sizeof(BoidRecord) + header->numScores * sizeof(ScoreRecord)) {
+        URHO3D_LOGERRORF("Checkpoint %s is invalid", path.CString());
+        return false;
+    }
+
+    const BoidRecord* records = reinterpret_cast<const BoidRecord*>(file.data + sizeof(CheckpointHeader));
+    const ScoreRecord* scores = reinterpret_cast<const ScoreRecord*>(records + header->numBoids);
+
+    int numSmall = 0;
+    for (unsigned i = 0; i < header->numBoids; i++) {
+        if (!records[i].isBig) numSmall++;
+    }
+
+    boids.Initialise(pRes, pScene, numSmall, header->numBoids - numSmall);
+
+    // Spawn puts small boids first, records are matched to them by species in order
+    unsigned nextSmall = 0, nextBig = numSmall;
+    for (unsigned i = 0; i < header->numBoids; i++) {
+        Boid& boid = boids.boidList[records[i].isBig ? nextBig++ : nextSmall++];
+
+        boid.pRigidBody->SetPosition(records[i].position);
+        boid.pRigidBody->SetLinearVelocity(records[i].velocity);
+        boid.pNode->SetEnabled(records[i].alive != 0);
+    }
+
+    boids.UpdateGrid();
+    SetRandomSeed(header->randomSeed);
+
+    scores_.Resize(header->numScores);
+    if (header->numScores) memcpy(&scores_[0], scores, header->numScores * sizeof(ScoreRecord));
+
+    URHO3D_LOGINFOF("Restored %u boids and %u scores from %s in %.2f ms", header->numBoids, header->numScores,
+        path.CString(), timer.GetUSec(false) / 1000.0f);
+    return true;
+}
+
+int Checkpoint::TakeScore(Connection* connection) {
+    String player = GetPlayerKey(connection);
+    for (unsigned i = 0; i < scores_.Size(); i++) {
+        if (player == scores_[i].player) {
+            int score = scores_[i].score;
+            scores_.Erase(i);
+            return score;
+        }
+    }
+
+    return 0;
+}
+
+String Checkpoint::GetPlayerKey(Connection* connection) {
+    // Clients without a token fall back to their address, shared by everyone behind the same NAT
+    const VariantMap& identity = connection->GetIdentity();
+    VariantMap::ConstIterator token = identity.Find(PLAYER_TOKEN);
+    if (token != identity.End() && !token->second_.GetString().Empty()) return token->second_.GetString();
+    return connection->GetAddress();
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/Container/HashMap.h>
+#include <atomic>
+
+#include "Boids.h"
+#include "Player.h"
+
+namespace Urho3D {
+    class Connection;
+}
+
+using namespace Urho3D;
+
+const static unsigned CheckpointVersion = 2;
+
+// File layout: header, numBoids boid records, numScores score records
+struct CheckpointHeader {
+    char id[4];
+    unsigned version;
+    unsigned randomSeed;
+    unsigned numBoids;
+    unsigned numScores;
+};
+
+struct BoidRecord {
+    Vector3 position;
+    Vector3 velocity;
+    unsigned char isBig;
+    unsigned char alive;
+    unsigned short padding;
+};
+
+struct ScoreRecord {
+    char player[48]; // GetPlayerKey of the connection
+    int score;
+};
+
+// Random token a client sends as PLAYER_TOKEN, so its score survives a restart even when it shares an address
+String CreatePlayerToken();
+
+// Writes a finished checkpoint buffer to disk off the main thread
+class CheckpointWriter : public Thread {
+public:
+    String path;
+    PODVector<unsigned char> buffer;
+    std::atomic<bool> finished{true}; // Set by the writer thread, read by the tick
+
+    virtual void ThreadFunction();
+};
+
+// Periodically captures boid state and player scores, a slice of boids per tick, for fast server restarts
+class Checkpoint : public Object {
+    URHO3D_OBJECT(Checkpoint, Object);
+
+public:
+    String path;
+    float interval = 5.0f; // Seconds between checkpoints
+    unsigned sliceSize = 4096; // Boids captured per tick
+
+    // Methods
+    Checkpoint(Context* context);
+    ~Checkpoint();
+    void Update(float timeStep, BoidSet& boids, HashMap<Connection*, Player*>& players);
+    bool Restore(ResourceCache* pRes, Scene* pScene, BoidSet& boids);
+    int TakeScore(Connection* connection);
+    static String GetPlayerKey(Connection* connection);
+
+private:
+    CheckpointWriter writer_;
+    PODVector<ScoreRecord> scores_; // Restored scores waiting for their player to reconnect
+    float timer_ = 0.0f;
+    unsigned captured_ = 0;
+    bool capturing_ = false;
+};
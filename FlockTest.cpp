@@ -0,0 +1,347 @@
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Math/Random.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <cmath>
+
+#include "FlockTest.h"
+
+const char* FlockPathNames[NUM_FLOCK_PATHS] = { "serial", "parallel", "regions" };
+
+static const FlockScenario FlockScenarios[] = {
+    { "default", 1, NumSmall, NumMedium, 0, 300 },
+    { "players", 2, NumSmall, NumMedium, 4, 300 },
+    { "crowded", 3, 1000, 1000, 2, 120 }
+};
+
+void ReferenceFlock::Capture(const BoidSet& set) {
+    // Grid cells are the reference's own, from its last UpdateGrid
+    boids.Resize(set.boidList.Size());
+    for (unsigned i = 0; i < boids.Size(); i++) {
+        const Boid& source = set.boidList[i];
+        ReferenceBoid& boid = boids[i];
+
+        boid.position = source.pRigidBody->GetPosition();
+        boid.velocity = source.pRigidBody->GetLinearVelocity();
+        boid.isBig = source.isBig;
+        boid.enabled = source.pNode->IsEnabled();
+    }
+}
+
+void ReferenceFlock::ComputeForces(const Vector<Vector3>& playerPositions) {
+    for (unsigned i = 0; i < boids.Size(); i++) {
+        const ReferenceBoid& boid = boids[i];
+        Vector<int> neighbours = grid_[boid.gridX][boid.gridZ];
+
+        if (boid.gridX + 1 < 20 && boid.gridZ + 1 < 20) neighbours += grid_[boid.gridX + 1][boid.gridZ + 1];
+        if (boid.gridX - 1 > 0 && boid.gridZ + 1 < 20) neighbours += grid_[boid.gridX - 1][boid.gridZ + 1];
+        if (boid.gridX + 1 < 20 && boid.gridZ - 1 > 0) neighbours += grid_[boid.gridX + 1][boid.gridZ - 1];
+        if (boid.gridX - 1 > 0 && boid.gridZ - 1 > 0) neighbours += grid_[boid.gridX - 1][boid.gridZ - 1];
+        if (boid.gridX + 1 < 20) neighbours += grid_[boid.gridX + 1][boid.gridZ];
+        if (boid.gridX - 1 > 0) neighbours += grid_[boid.gridX - 1][boid.gridZ];
+        if (boid.gridZ + 1 < 20) neighbours += grid_[boid.gridX][boid.gridZ + 1];
+        if (boid.gridZ - 1 > 0) neighbours += grid_[boid.gridX][boid.gridZ - 1];
+
+        ComputeForce(i, playerPositions, neighbours);
+    }
+}
+
+void ReferenceFlock::ComputeForce(unsigned index, const Vector<Vector3>& playerPositions, const Vector<int>& neighbours) {
+    const float separationRange = 30.0f;
+    const float separationFactor = 4.0f;
+    const float cohesionRange = 30.0f;
+    const float cohesionFactor = 5.0f;
+    const float alignmentRange = 5.0f;
+    const float alignmentFactor = 2.0f;
+    const float velocityMax = 5.0f;
+
+    ReferenceBoid& boid = boids[index];
+    Vector3 fs, fc, fa;
+    Vector3 pos = boid.position;
+    Vector3 pMean, vMean;
+    int pN = 0, vN = 0;
+
+    for (unsigned p = 0; p < playerPositions.Size(); p++) {
+        Vector3 pDelta = pos - playerPositions[p];
+
+        if (pDelta.Length() < separationRange) {
+            fs += 10 * (pDelta / pDelta.Length());
+        }
+    }
+
+    for (unsigned n = 0; n < neighbours.Size(); n++) {
+        unsigned i = neighbours[n];
+        if (i == index || !boid.enabled || !boids[i].enabled) continue;
+
+        Vector3 pDelta = pos - boids[i].position;
+
+        if (boid.isBig == boids[i].isBig) {
+            if (pDelta.Length() < cohesionRange) {
+                pMean += boids[i].position;
+                pN++;
+            } if (pDelta.Length() < alignmentRange) {
+                vMean += boids[i].velocity;
+                vN++;
+            } if (pDelta.Length() < separationRange) {
+                fs += (pDelta / pDelta.Length());
+            }
+        }
+    }
+
+    if (pN > 0) {
+        pMean /= pN;
+        fc = (((pMean - pos) / (pMean - pos).Length()) * velocityMax) - boid.velocity;
+    }
+
+    if (vN > 0) {
+        vMean /= vN;
+        fa = vMean - boid.velocity;
+    }
+
+    if (pos.x_ > 90) fs += Vector3(-(abs(pos.x_) - 90), 0, 0);
+    else if (pos.x_ < -90) fs += Vector3((abs(pos.x_) - 90), 0, 0);
+    if (pos.y_ > 40) fs += Vector3(0, -(abs(pos.y_) - 40), 0);
+    else if (pos.y_ < 10) fs += Vector3(0, 10 - (abs(pos.y_)), 0);
+    if (pos.z_ > 90) fs += Vector3(0, 0, -(abs(pos.z_) - 90));
+    else if (pos.z_ < -90) fs += Vector3(0, 0, (abs(pos.z_) - 90));
+
+    boid.force = (fs * separationFactor) + (fc * cohesionFactor) + (fa * alignmentFactor);
+}
+
+void ReferenceFlock::UpdateGrid() {
+    for (int i = 0; i < GridSize; i++) {
+        for (int j = 0; j < GridSize; j++) grid_[i][j].Clear();
+    }
+
+    for (unsigned i = 0; i < boids.Size(); i++) {
+        Vector3 pos = boids[i].position;
+        int x = (pos.x_ + GridSize * GridCellSize * 0.5f) / GridCellSize;
+        int z = (pos.z_ + GridSize * GridCellSize * 0.5f) / GridCellSize;
+
+        if (x < 0) x = 0;
+        else if (x > GridSize - 1) x = GridSize - 1;
+        if (z < 0) z = 0;
+        else if (z > GridSize - 1) z = GridSize - 1;
+
+        boids[i].gridX = x;
+        boids[i].gridZ = z;
+        grid_[x][z].Push(i);
+    }
+}
+
+FlockTest::FlockTest(Context* context) : Object(context) {}
+
+Arena* FlockTest::CreateArena(const FlockScenario& scenario, unsigned index) {
+    Arena* arena = new Arena(index);
+    arena->scene = CreateArenaScene(context_);
+
+    // Every arena of a scenario starts from the same flock
+    SetRandomSeed(scenario.seed);
+    arena->boids.Initialise(GetSubsystem<ResourceCache>(), arena->scene, scenario.numSmall, scenario.numBig);
+    return arena;
+}
+
+FlockResult FlockTest::RunPath(const FlockScenario& scenario, FlockPath path) {
+    FlockResult result;
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    TickScratch* scratch = GetSubsystem<TickScratch>();
+
+    SetRandomSeed(scenario.seed + 1);
+    Vector<Vector3> players;
+    for (unsigned i = 0; i < scenario.numPlayers; i++) {
+        players.Push(Vector3(Random(180.0f) - 90.0f, Random(30.0f) + 10.0f, Random(180.0f) - 90.0f));
+    }
+    Vector<Vector3> wakePositions = players;
+    wakePositions.Push(Vector3(-50.0f, 25.0f, -50.0f));
+
+    Vector<SharedPtr<Arena> > arenas;
+    unsigned numArenas = path == FLOCK_PARALLEL ? NumParallelArenas : 1;
+    for (unsigned i = 0; i < numArenas; i++) {
+        arenas.Push(SharedPtr<Arena>(CreateArena(scenario, i)));
+        arenas[i]->playerPositions = players;
+    }
+    if (path == FLOCK_REGIONS) arenas[0]->boids.wakeRadius = FlockTestWakeRadius;
+
+    // One reference follows each arena of the path for the force and grid checks; another drives an arena of its own
+    // for the trajectory check
+    SharedPtr<Arena> referenceArena(CreateArena(scenario, numArenas));
+    ReferenceFlock reference;
+    reference.Capture(referenceArena->boids);
+    reference.UpdateGrid();
+
+    Vector<ReferenceFlock> trackers(numArenas);
+    for (unsigned i = 0; i < numArenas; i++) {
+        trackers[i].Capture(arenas[i]->boids);
+        trackers[i].UpdateGrid();
+    }
+
+    HiresTimer timer;
+    long long pathTime = 0, referenceTime = 0;
+    PODVector<Vector3> frozen;
+
+    for (unsigned step = 0; step < scenario.steps; step++) {
+        if (path == FLOCK_REGIONS) arenas[0]->boids.UpdateRegions(wakePositions, FlockTestTimeStep);
+
+        timer.Reset();
+        switch (path) {
+        case FLOCK_SERIAL:
+        case FLOCK_REGIONS:
+            arenas[0]->boids.ComputeForces(players, scratch->Get(0));
+            break;
+        case FLOCK_PARALLEL:
+            ComputeArenaForces(queue, arenas);
+            break;
+        default:
+            break;
+        }
+        pathTime += timer.GetUSec(true);
+
+        for (unsigned i = 0; i < numArenas; i++) {
+            BoidSet& boids = arenas[i]->boids;
+            trackers[i].Capture(boids);
+            trackers[i].ComputeForces(players);
+
+            for (unsigned j = 0; j < boids.boidList.Size(); j++) {
+                if (!boids.IsActive(boids.boidList[j])) continue;
+
+                const Vector3& expected = trackers[i].boids[j].force;
+                float error = (boids.boidList[j].force - expected).Length() / Max(expected.Length(), 1.0f);
+                result.forceError = Max(result.forceError, error);
+            }
+
+            boids.Integrate(FlockTestTimeStep);
+            timer.Reset();
+            boids.UpdateGrid();
+            pathTime += timer.GetUSec(true);
+
+            trackers[i].UpdateGrid();
+            for (unsigned j = 0; j < boids.boidList.Size(); j++) {
+                const Boid& boid = boids.boidList[j];
+                if (boid.gridX != trackers[i].boids[j].gridX || boid.gridZ != trackers[i].boids[j].gridZ) result.gridErrors++;
+            }
+        }
+
+        timer.Reset();
+        reference.Capture(referenceArena->boids);
+        reference.ComputeForces(players);
+        referenceTime += timer.GetUSec(true);
+        for (unsigned j = 0; j < reference.boids.Size(); j++) referenceArena->boids.boidList[j].force = reference.boids[j].force;
+        referenceArena->boids.Integrate(FlockTestTimeStep);
+        timer.Reset();
+        reference.UpdateGrid();
+        referenceTime += timer.GetUSec(true);
+
+        // Dormant boids must stay where they are, whether or not their bodies were taken out of the physics world
+        BoidSet& first = arenas[0]->boids;
+        frozen.Resize(first.boidList.Size());
+        for (unsigned j = 0; j < first.boidList.Size(); j++) frozen[j] = first.boidList[j].pRigidBody->GetPosition();
+
+        for (unsigned i = 0; i < numArenas; i++) arenas[i]->scene->GetComponent<PhysicsWorld>()->Update(FlockTestTimeStep);
+        referenceArena->scene->GetComponent<PhysicsWorld>()->Update(FlockTestTimeStep);
+        scratch->EndTick(); // The steps run outside the engine's frames
+
+        for (unsigned j = 0; j < first.boidList.Size(); j++) {
+            const Boid& boid = first.boidList[j];
+            if (!first.IsActive(boid) && boid.pRigidBody->GetPosition() != frozen[j]) result.frozenMoved++;
+        }
+
+        // Dormancy changes the flock by design, the regions path is only held to the reference where it computes
+        if (path == FLOCK_REGIONS) continue;
+
+        for (unsigned i = 0; i < numArenas; i++) {
+            const BoidSet& boids = arenas[i]->boids;
+            for (unsigned j = 0; j < boids.boidList.Size(); j++) {
+                Vector3 position = boids.boidList[j].pRigidBody->GetPosition();
+                Vector3 expected = referenceArena->boids.boidList[j].pRigidBody->GetPosition();
+                result.divergence = Max(result.divergence, (position - expected).Length());
+            }
+        }
+    }
+
+    result.time = pathTime / 1000.0f / scenario.steps;
+    result.referenceTime = referenceTime / 1000.0f / scenario.steps;
+    return result;
+}
+
+bool FlockTest::Run(const String& baselinePath) {
+    HashMap<String, float> times;
+    bool passed = true;
+
+    // Without a baseline the timing check could never fail, so it is recorded only on request
+    if (!saveBaseline && !LoadBaseline(baselinePath)) {
+        URHO3D_LOGERRORF("Flock test: no baseline at %s, record one with -flocktestsave", baselinePath.CString());
+        passed = false;
+    }
+
+    for (unsigned i = 0; i < sizeof(FlockScenarios) / sizeof(FlockScenarios[0]); i++) {
+        const FlockScenario& scenario = FlockScenarios[i];
+
+        for (unsigned j = 0; j < NUM_FLOCK_PATHS; j++) {
+            String name = String(scenario.name) + "/" + FlockPathNames[j];
+            FlockResult result = RunPath(scenario, (FlockPath)j);
+            times[name] = result.time;
+
+            String failures;
+            if (result.forceError > forceTolerance) failures += " forces";
+            if (result.divergence > positionTolerance) failures += " trajectory";
+            if (result.gridErrors) failures += " grid";
+            if (result.frozenMoved) failures += " dormant boids moved";
+
+            String baseline = "none";
+            HashMap<String, float>::ConstIterator saved = baseline_.Find(name);
+            if (saved != baseline_.End()) {
+                baseline = ToString("%.3f ms", saved->second_);
+                if (result.time > saved->second_ * (1.0f + slowdownThreshold) && result.time - saved->second_ > minTimeDifference) {
+                    failures += " slowdown";
+                }
+            }
+
+            URHO3D_LOGINFOF("Flock test %s: force error %.6f, divergence %.4f m, %u grid errors, %.3f ms per step "
+                "(reference %.3f ms, baseline %s)", name.CString(), result.forceError, result.divergence, result.gridErrors,
+                result.time, result.referenceTime, baseline.CString());
+            if (!failures.Empty()) {
+                URHO3D_LOGERRORF("Flock test %s failed:%s", name.CString(), failures.CString());
+                passed = false;
+            }
+        }
+    }
+
+    if (saveBaseline) {
+        if (SaveBaseline(baselinePath, times)) {
+            URHO3D_LOGINFOF("Flock test: baseline written to %s", baselinePath.CString());
+        } else {
+            URHO3D_LOGERRORF("Flock test: could not write baseline to %s", baselinePath.CString());
+            passed = false;
+        }
+    }
+
+    URHO3D_LOGINFO(passed ? "Flock test passed" : "Flock test failed");
+    return passed;
+}
+
+bool FlockTest::LoadBaseline(const String& path) {
+    baseline_.Clear();
+
+    File file(context_, path, FILE_READ);
+    if (!file.IsOpen()) return false;
+
+    // One "scenario/path milliseconds" per line
+    while (!file.IsEof()) {
+        Vector<String> fields = file.ReadLine().Trimmed().Split(' ');
+        if (fields.Size() == 2) baseline_[fields[0]] = ToFloat(fields[1]);
+    }
+    return true;
+}
+
+bool FlockTest::SaveBaseline(const String& path, const HashMap<String, float>& times) const {
+    File file(context_, path, FILE_WRITE);
+    if (!file.IsOpen()) return false;
+
+    for (HashMap<String, float>::ConstIterator i = times.Begin(); i != times.End(); ++i) {
+        file.WriteLine(i->first_ + ToString(" %.4f", i->second_));
+    }
+    return true;
+}
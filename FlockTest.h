@@ -0,0 +1,95 @@
+#pragma once
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Container/HashMap.h>
+
+#include "Arena.h"
+
+using namespace Urho3D;
+
+const static float FlockTestTimeStep = 1.0f / 60.0f;
+const static unsigned NumParallelArenas = 4; // Identical arenas flocked together on the work queue
+const static float FlockTestWakeRadius = 40.0f; // Regions path, leaves most of the arena dormant
+
+// A fixed-seed flock to run every path through
+struct FlockScenario {
+    const char* name;
+    unsigned seed;
+    int numSmall;
+    int numBig;
+    unsigned numPlayers; // Stationary, at seeded positions
+    unsigned steps;
+};
+
+// The ways the server can compute the flock. New optimisations get an entry here and a case in FlockTest::RunPath.
+enum FlockPath {
+    FLOCK_SERIAL = 0, // BoidSet::ComputeForces on the calling thread
+    FLOCK_PARALLEL, // Several arenas through ComputeArenaForces on the work queue
+    FLOCK_REGIONS, // Dormant regions away from the players, forces of the active boids only
+    NUM_FLOCK_PATHS
+};
+
+extern const char* FlockPathNames[NUM_FLOCK_PATHS];
+
+// Boid state captured from a BoidSet, and the flocking computed on it by the reference algorithm
+struct ReferenceBoid {
+    Vector3 position;
+    Vector3 velocity;
+    Vector3 force;
+    bool isBig;
+    bool enabled;
+    int gridX, gridZ;
+};
+
+// Today's scalar Boid::ComputeForce and BoidSet::UpdateGrid, copied over plain captured state, quirks included. It is
+// what every other path is measured against, so it must not be optimised or fixed along with them.
+class ReferenceFlock {
+public:
+    PODVector<ReferenceBoid> boids;
+
+    // Methods
+    void Capture(const BoidSet& set);
+    void ComputeForces(const Vector<Vector3>& playerPositions);
+    void UpdateGrid();
+
+private:
+    Vector<int> grid_[GridSize][GridSize];
+
+    void ComputeForce(unsigned index, const Vector<Vector3>& playerPositions, const Vector<int>& neighbours);
+};
+
+// Worst case of one scenario through one path
+struct FlockResult {
+    float forceError = 0.0f; // Relative to the reference force
+    float divergence = 0.0f; // Metres between the path's and the reference's trajectories
+    unsigned gridErrors = 0; // Boids the path put in a different grid cell than the reference
+    unsigned frozenMoved = 0; // Dormant boids that moved
+    float time = 0.0f; // Milliseconds per step, forces and grid
+    float referenceTime = 0.0f;
+};
+
+// Regression run started by -flocktest: every scenario through every path, with forces, grid cells and
+// trajectories checked against the reference and timings against a saved baseline. The run fails on divergence past
+// the tolerances, a slowdown past slowdownThreshold, or a missing baseline. CMake runs it as the flocktest test
+// against the committed flocktest-baseline.txt.
+class FlockTest : public Object {
+    URHO3D_OBJECT(FlockTest, Object);
+
+public:
+    float forceTolerance = 1e-3f;
+    float positionTolerance = 0.01f;
+    float slowdownThreshold = 0.2f; // Fraction over the baseline time
+    float minTimeDifference = 0.05f; // Milliseconds, differences below this are noise whatever the fraction
+    bool saveBaseline = false; // Write the timings as the new baseline instead of comparing against it
+
+    // Methods
+    FlockTest(Context* context);
+    bool Run(const String& baselinePath);
+
+private:
+    HashMap<String, float> baseline_; // Milliseconds per step by "scenario/path"
+
+    FlockResult RunPath(const FlockScenario& scenario, FlockPath path);
+    Arena* CreateArena(const FlockScenario& scenario, unsigned index);
+    bool LoadBaseline(const String& path);
+    bool SaveBaseline(const String& path, const HashMap<String, float>& times) const;
+};
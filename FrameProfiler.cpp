@@ -0,0 +1,248 @@
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Engine/EngineEvents.h>
+#include <Urho3D/Graphics/GraphicsEvents.h>
+#include <Urho3D/Input/InputEvents.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Network/NetworkEvents.h>
+#include <Urho3D/Physics/PhysicsEvents.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/UI/Font.h>
+#include <Urho3D/UI/Text.h>
+#include <Urho3D/UI/UI.h>
+#include <cstring>
+
+#include "FrameProfiler.h"
+
+const float FrameTimeBins[NumFrameTimeBins - 1] = { 8.3f, 16.7f, 25.0f, 33.3f, 50.0f, 66.7f, 100.0f };
+
+FrameProfiler::FrameProfiler(Context* context) : Object(context) {
+    SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(FrameProfiler, HandleBeginFrame));
+    SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(FrameProfiler, HandleEndFrame));
+    SubscribeToEvent(E_PHYSICSPOSTSTEP, URHO3D_HANDLER(FrameProfiler, HandlePhysicsPostStep));
+    SubscribeToEvent(E_NETWORKUPDATE, URHO3D_HANDLER(FrameProfiler, HandleNetworkUpdate));
+    SubscribeToEvent(E_NETWORKUPDATESENT, URHO3D_HANDLER(FrameProfiler, HandleNetworkUpdateSent));
+    SubscribeToEvent(E_BEGINVIEWRENDER, URHO3D_HANDLER(FrameProfiler, HandleBeginViewRender));
+    SubscribeToEvent(E_ENDVIEWRENDER, URHO3D_HANDLER(FrameProfiler, HandleEndViewRender));
+    SubscribeToEvent(E_KEYDOWN, URHO3D_HANDLER(FrameProfiler, HandleKeyDown));
+    SubscribeToEvent(E_CONSOLECOMMAND, URHO3D_HANDLER(FrameProfiler, HandleConsoleCommand));
+}
+
+int FrameProfiler::FindSection(const char* name, int parent) {
+    for (unsigned i = 0; i < sections_.Size(); i++) {
+        if (sections_[i].parent == parent && !strcmp(sections_[i].name, name)) return i;
+    }
+
+    ProfileSection section;
+    section.name = name;
+    section.parent = parent;
+    section.depth = parent >= 0 ? sections_[parent].depth + 1 : 0;
+    sections_.Push(section);
+    return sections_.Size() - 1;
+}
+
+void FrameProfiler::GetTreeOrder(int parent, PODVector<unsigned>& order) const {
+    for (unsigned i = 0; i < sections_.Size(); i++) {
+        if (sections_[i].parent != parent) continue;
+
+        order.Push(i);
+        GetTreeOrder(i, order);
+    }
+}
+
+void FrameProfiler::Begin(const char* name) {
+    int section = FindSection(name, stack_.Empty() ? -1 : stack_.Back());
+    stack_.Push(section);
+    scopeTimers_.Push(HiresTimer());
+}
+
+void FrameProfiler::End() {
+    if (stack_.Empty()) return;
+
+    sections_[stack_.Back()].frameTime += scopeTimers_.Back().GetUSec(false) / 1000.0f;
+    stack_.Pop();
+    scopeTimers_.Pop();
+}
+
+void FrameProfiler::BeginPhysicsStep() {
+    Begin("Physics step");
+    physicsStep_ = true;
+}
+
+ProfileStats FrameProfiler::GetStats(const float* history) const {
+    ProfileStats stats = {};
+    unsigned count = GetNumFrames();
+    if (!count) return stats;
+
+    PODVector<float> sorted(history, count);
+    Sort(sorted.Begin(), sorted.End());
+
+    for (unsigned i = 0; i < count; i++) stats.average += sorted[i];
+    stats.average /= count;
+    stats.min = sorted.Front();
+    stats.max = sorted.Back();
+    stats.p99 = sorted[Min((unsigned)(0.99f * count), count - 1)];
+    return stats;
+}
+
+ProfileStats FrameProfiler::GetStats(unsigned section) const {
+    return GetStats(sections_[section].history);
+}
+
+ProfileStats FrameProfiler::GetFrameStats() const {
+    return GetStats(frameTimes_);
+}
+
+String FrameProfiler::GetReport() const {
+    ProfileStats frame = GetFrameStats();
+    PODVector<unsigned> order;
+    GetTreeOrder(-1, order);
+
+    String report;
+    String title = "ms over " + String(GetNumFrames()) + " frames";
+    report.AppendWithFormat("%-24s %7s %7s %7s %7s\n", title.CString(), "min", "avg", "p99", "max");
+    report.AppendWithFormat("%-24s %7.2f %7.2f %7.2f %7.2f\n", "Frame", frame.min, frame.average, frame.p99, frame.max);
+
+    for (unsigned j = 0; j < order.Size(); j++) {
+        unsigned i = order[j];
+        ProfileStats stats = GetStats(i);
+        String name = String(' ', (sections_[i].depth + 1) * 2) + sections_[i].name;
+        report.AppendWithFormat("%-24s %7.2f %7.2f %7.2f %7.2f\n", name.CString(), stats.min, stats.average, stats.p99, stats.max);
+    }
+
+    // Histogram over every frame since start, slow frames are rare and should not roll out of view
+    unsigned total = 0;
+    for (unsigned i = 0; i < NumFrameTimeBins; i++) total += histogram_[i];
+    report += "\nFrame time";
+    for (unsigned i = 0; i < NumFrameTimeBins; i++) {
+        String bin = i < NumFrameTimeBins - 1 ? "<" + String((int)(FrameTimeBins[i] + 0.5f)) : ">" + String((int)FrameTimeBins[i - 1]);
+        report.AppendWithFormat(" %s %.1f%%", bin.CString(), total ? histogram_[i] * 100.0f / total : 0.0f);
+    }
+    return report;
+}
+
+bool FrameProfiler::WriteCsv(const String& path) const {
+    File file(context_, path, FILE_WRITE);
+    if (!file.IsOpen()) return false;
+
+    file.WriteLine("section,parent,depth,min_ms,avg_ms,p99_ms,max_ms");
+    ProfileStats frame = GetFrameStats();
+    PODVector<unsigned> order;
+    GetTreeOrder(-1, order);
+
+    file.WriteLine(ToString("Frame,,0,%.3f,%.3f,%.3f,%.3f", frame.min, frame.average, frame.p99, frame.max));
+    for (unsigned j = 0; j < order.Size(); j++) {
+        unsigned i = order[j];
+        ProfileStats stats = GetStats(i);
+        const char* parent = sections_[i].parent >= 0 ? sections_[sections_[i].parent].name : "Frame";
+        file.WriteLine(ToString("%s,%s,%u,%.3f,%.3f,%.3f,%.3f", sections_[i].name, parent, sections_[i].depth + 1,
+            stats.min, stats.average, stats.p99, stats.max));
+    }
+
+    file.WriteLine("");
+    file.WriteLine("frame_time_below_ms,frames");
+    for (unsigned i = 0; i < NumFrameTimeBins; i++) {
+        file.WriteLine(ToString("%s,%u", i < NumFrameTimeBins - 1 ? String(FrameTimeBins[i]).CString() : "inf", histogram_[i]));
+    }
+    return true;
+}
+
+void FrameProfiler::SetOverlayVisible(bool enable) {
+    UI* ui = GetSubsystem<UI>();
+    if (!ui) return;
+
+    if (!overlay_) {
+        overlay_ = ui->GetRoot()->CreateChild<Text>();
+        overlay_->SetFont(GetSubsystem<ResourceCache>()->GetResource<Font>("Fonts/Anonymous Pro.ttf"), 10);
+        overlay_->SetAlignment(HA_RIGHT, VA_TOP);
+        overlay_->SetPosition(-10, 10);
+        overlay_->SetPriority(100);
+    }
+    overlay_->SetVisible(enable);
+    overlayTimer_ = 0.0f;
+}
+
+void FrameProfiler::HandleBeginFrame(StringHash eventType, VariantMap& eventData) {
+    frameTimer_.Reset();
+}
+
+void FrameProfiler::HandleEndFrame(StringHash eventType, VariantMap& eventData) {
+    // Scopes left open by an unbalanced Begin would otherwise swallow every following frame
+    while (!stack_.Empty()) End();
+    physicsStep_ = false;
+
+    float frameTime = frameTimer_.GetUSec(false) / 1000.0f;
+    unsigned slot = frame_ % ProfileFrames;
+    frameTimes_[slot] = frameTime;
+    for (unsigned i = 0; i < sections_.Size(); i++) {
+        sections_[i].history[slot] = sections_[i].frameTime;
+        sections_[i].frameTime = 0.0f;
+    }
+    frame_++;
+
+    unsigned bin = 0;
+    while (bin < NumFrameTimeBins - 1 && frameTime >= FrameTimeBins[bin]) bin++;
+    histogram_[bin]++;
+
+    // The overlay is refreshed a few times a second, sorting every section each frame would show up in itself. Both
+    // timers count elapsed time, frameTime is only the busy part of the frame.
+    float timeStep = GetSubsystem<Time>()->GetTimeStep();
+    overlayTimer_ += timeStep;
+    if (overlay_ && overlay_->IsVisible() && overlayTimer_ >= 0.25f) {
+        overlay_->SetText(GetReport());
+        overlayTimer_ = 0.0f;
+    }
+
+    csvTimer_ += timeStep;
+    if (!csvPath.Empty() && csvTimer_ >= csvInterval) {
+        if (!WriteCsv(csvPath)) URHO3D_LOGERRORF("Could not write profile to %s", csvPath.CString());
+        csvTimer_ = 0.0f;
+    }
+}
+
+void FrameProfiler::HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData) {
+    if (!physicsStep_) return;
+
+    End();
+    physicsStep_ = false;
+}
+
+void FrameProfiler::HandleNetworkUpdate(StringHash eventType, VariantMap& eventData) {
+    Begin("Network send");
+}
+
+void FrameProfiler::HandleNetworkUpdateSent(StringHash eventType, VariantMap& eventData) {
+    End();
+}
+
+void FrameProfiler::HandleBeginViewRender(StringHash eventType, VariantMap& eventData) {
+    using namespace BeginViewRender;
+
+    // The water reflection is the only view rendered to a texture
+    Begin(eventData[P_TEXTURE].GetPtr() ? "Reflection render" : "Main render");
+}
+
+void FrameProfiler::HandleEndViewRender(StringHash eventType, VariantMap& eventData) {
+    End();
+}
+
+void FrameProfiler::HandleKeyDown(StringHash eventType, VariantMap& eventData) {
+    using namespace KeyDown;
+
+    if (eventData[P_KEY].GetInt() == KEY_F3) SetOverlayVisible(!overlay_ || !overlay_->IsVisible());
+}
+
+void FrameProfiler::HandleConsoleCommand(StringHash eventType, VariantMap& eventData) {
+    using namespace ConsoleCommand;
+
+    if (eventData[P_ID].GetString() != GetTypeName()) return;
+
+    Vector<String> command = eventData[P_COMMAND].GetString().Trimmed().Split(' ');
+    if (command.Empty() || command[0] != "profilecsv") return;
+
+    String path = command.Size() > 1 ? command[1] : String("profile.csv");
+    if (WriteCsv(path)) URHO3D_LOGINFOF("Profile written to %s", path.CString());
+    else URHO3D_LOGERRORF("Could not write profile to %s", path.CString());
+}
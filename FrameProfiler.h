@@ -0,0 +1,92 @@
+#pragma once
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+
+namespace Urho3D {
+    class Text;
+}
+
+using namespace Urho3D;
+
+const static unsigned ProfileFrames = 300; // Rolling window the statistics cover, 5 seconds at 60 fps
+const static unsigned NumFrameTimeBins = 8;
+
+// Upper bounds of the frame time histogram bins in milliseconds, the last bin takes everything above
+extern const float FrameTimeBins[NumFrameTimeBins - 1];
+
+// Time spent in one named scope under one parent, for each of the last ProfileFrames frames
+struct ProfileSection {
+    const char* name;
+    int parent; // -1 at the top level
+    unsigned depth;
+    float frameTime = 0.0f; // Milliseconds so far this frame, a scope entered several times adds up
+    float history[ProfileFrames] = {};
+};
+
+// Summary of a section, or of the whole frame, over the window
+struct ProfileStats {
+    float min;
+    float average;
+    float p99;
+    float max;
+};
+
+// Subsystem timing scopes on the main thread into a per-frame hierarchy. Besides the scopes placed in the game code,
+// it times the physics step from pre-step to post-step, the network send and each rendered view itself from engine
+// events. F3 toggles an overlay with min/avg/p99 per section and a frame time histogram; the "profilecsv" console
+// command, or csvPath when set, writes the same as CSV.
+class FrameProfiler : public Object {
+    URHO3D_OBJECT(FrameProfiler, Object);
+
+public:
+    String csvPath; // Rewritten every csvInterval seconds when not empty
+    float csvInterval = 10.0f;
+
+    // Methods
+    FrameProfiler(Context* context);
+    void Begin(const char* name);
+    void End();
+    void BeginPhysicsStep(); // From the last pre-step handler, ended by the post-step
+    ProfileStats GetStats(unsigned section) const;
+    ProfileStats GetFrameStats() const;
+    String GetReport() const;
+    bool WriteCsv(const String& path) const;
+    void SetOverlayVisible(bool enable);
+
+private:
+    Vector<ProfileSection> sections_;
+    PODVector<int> stack_;
+    HiresTimer frameTimer_;
+    PODVector<HiresTimer> scopeTimers_; // Parallel to stack_
+    float frameTimes_[ProfileFrames] = {};
+    unsigned histogram_[NumFrameTimeBins] = {};
+    unsigned frame_ = 0;
+    float overlayTimer_ = 0.0f;
+    float csvTimer_ = 0.0f;
+    bool physicsStep_ = false;
+    SharedPtr<Text> overlay_;
+
+    int FindSection(const char* name, int parent);
+    void GetTreeOrder(int parent, PODVector<unsigned>& order) const; // Depth first, parents before children
+    unsigned GetNumFrames() const { return Min(frame_, ProfileFrames); }
+    ProfileStats GetStats(const float* history) const;
+    void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+    void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+    void HandlePhysicsPostStep(StringHash eventType, VariantMap& eventData);
+    void HandleNetworkUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleNetworkUpdateSent(StringHash eventType, VariantMap& eventData);
+    void HandleBeginViewRender(StringHash eventType, VariantMap& eventData);
+    void HandleEndViewRender(StringHash eventType, VariantMap& eventData);
+    void HandleKeyDown(StringHash eventType, VariantMap& eventData);
+    void HandleConsoleCommand(StringHash eventType, VariantMap& eventData);
+};
+
+// Times the enclosing block as a section of the innermost open one
+class ProfileScope {
+public:
+    ProfileScope(FrameProfiler* profiler, const char* name) : profiler_(profiler) { if (profiler_) profiler_->Begin(name); }
+    ~ProfileScope() { if (profiler_) profiler_->End(); }
+
+private:
+    FrameProfiler* profiler_;
+};
@@ -0,0 +1,125 @@
+#include <Urho3D/Network/Connection.h>
+
+#include "GameEvents.h"
+#include "Messages.h"
+
+bool GameEventBatch::Score(int score) {
+    bool merged = hasScore_;
+    score_ = score;
+    hasScore_ = true;
+    return !merged;
+}
+
+bool GameEventBatch::Kill(unsigned boidIndex, unsigned killerID) {
+    for (unsigned i = 0; i < kills_.Size(); i += 2) {
+        if (kills_[i] == boidIndex) return false;
+    }
+
+    kills_.Push(boidIndex);
+    kills_.Push(killerID);
+    return true;
+}
+
+void GameEventBatch::Write(VectorBuffer& dest, unsigned* channelBytes) const {
+    dest.Clear();
+    dest.WriteVLE(spawns_.Size() + (hasScore_ ? 1 : 0) + kills_.Size() / 2);
+
+    unsigned start = dest.GetPosition();
+    for (unsigned i = 0; i < spawns_.Size(); i++) {
+        dest.WriteUByte(GAME_SPAWN);
+        dest.WriteNetID(spawns_[i]);
+    }
+    if (channelBytes) channelBytes[NET_SPAWNS] += dest.GetPosition() - start;
+
+    start = dest.GetPosition();
+    if (hasScore_) {
+        dest.WriteUByte(GAME_SCORE);
+        dest.WriteInt(score_);
+    }
+    if (channelBytes) channelBytes[NET_SCORES] += dest.GetPosition() - start;
+
+    start = dest.GetPosition();
+    for (unsigned i = 0; i < kills_.Size(); i += 2) {
+        dest.WriteUByte(GAME_KILL);
+        dest.WriteVLE(kills_[i]);
+        dest.WriteNetID(kills_[i + 1]);
+    }
+    if (channelBytes) channelBytes[NET_KILLS] += dest.GetPosition() - start;
+}
+
+void GameEventBatch::Clear() {
+    spawns_.Clear();
+    kills_.Clear();
+    hasScore_ = false;
+}
+
+void ReadGameEvents(MemoryBuffer& source, PODVector<GameEvent>& events) {
+    unsigned count = source.ReadVLE();
+    events.Clear();
+
+    for (unsigned i = 0; i < count && !source.IsEof(); i++) {
+        GameEvent event = {};
+        event.type = (GameEventType)source.ReadUByte();
+
+        switch (event.type) {
+        case GAME_SPAWN:
+            event.nodeID = source.ReadNetID();
+            break;
+        case GAME_SCORE:
+            event.score = source.ReadInt();
+            break;
+        case GAME_KILL:
+            event.boidIndex = source.ReadVLE();
+            event.nodeID = source.ReadNetID();
+            break;
+        default:
+            return; // Unknown layout, nothing after it can be trusted
+        }
+
+        events.Push(event);
+    }
+}
+
+void GameEventServer::Spawn(Connection* connection, unsigned nodeID) {
+    batches_[connection].Spawn(nodeID);
+    eventsQueued++;
+}
+
+void GameEventServer::Score(Connection* connection, int score) {
+    eventsQueued++;
+    if (!batches_[connection].Score(score)) eventsMerged++;
+}
+
+void GameEventServer::Kill(const Vector<SharedPtr<Connection> >& connections, unsigned boidIndex, unsigned killerID) {
+    for (unsigned i = 0; i < connections.Size(); i++) {
+        if (!connections[i]->GetScene()) continue;
+
+        eventsQueued++;
+        if (!batches_[connections[i]].Kill(boidIndex, killerID)) eventsMerged++;
+    }
+}
+
+void GameEventServer::Send(const Vector<SharedPtr<Connection> >& connections) {
+    for (unsigned i = 0; i < connections.Size(); i++) {
+        HashMap<Connection*, GameEventBatch>::Iterator batch = batches_.Find(connections[i]);
+        if (batch == batches_.End() || batch->second_.Empty()) continue;
+
+        unsigned channelBytes[NUM_NET_CHANNELS] = {};
+        batch->second_.Write(message_, channelBytes);
+        connections[i]->SendMessage(MSG_GAMEEVENTS, true, true, message_);
+
+        if (stats) {
+            for (unsigned j = NET_SPAWNS; j <= NET_KILLS; j++) {
+                if (channelBytes[j]) stats->Count(connections[i], (NetChannel)j, channelBytes[j]);
+            }
+        }
+        batch->second_.Clear();
+        messagesSent++;
+    }
+}
+
+unsigned GameEventServer::GetMemoryUse() const {
+    unsigned bytes = message_.GetBuffer().Capacity();
+    for (HashMap<Connection*, GameEventBatch>::ConstIterator i = batches_.Begin(); i != batches_.End(); ++i) bytes += i->second_.GetMemoryUse();
+    return bytes;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+#include "NetStats.h"
+
+namespace Urho3D {
+    class Connection;
+}
+
+using namespace Urho3D;
+
+enum GameEventType {
+    GAME_SPAWN = 1, // The connection's own player was created
+    GAME_SCORE,     // The connection's score changed
+    GAME_KILL       // A boid was eaten
+};
+
+// One decoded gameplay event, only the fields of its type are set
+struct GameEvent {
+    GameEventType type;
+    unsigned nodeID; // Spawn: the player's node, kill: the killer's node
+    unsigned boidIndex; // Kill
+    int score; // Score
+};
+
+// Events queued for one connection during a network tick. Scores are coalesced to the latest value and a boid can
+// only die once, so a feeding frenzy still costs one message per tick.
+class GameEventBatch {
+public:
+    void Spawn(unsigned nodeID) { spawns_.Push(nodeID); }
+    bool Score(int score); // False when it replaced an unsent score
+    bool Kill(unsigned boidIndex, unsigned killerID); // False when the boid was already in the batch
+    bool Empty() const { return spawns_.Empty() && !hasScore_ && kills_.Empty(); }
+    void Write(VectorBuffer& dest, unsigned* channelBytes = nullptr) const; // Adds the bytes of each event type
+    void Clear();
+    unsigned GetMemoryUse() const { return sizeof(GameEventBatch) + (spawns_.Capacity() + kills_.Capacity()) * sizeof(unsigned); }
+
+private:
+    PODVector<unsigned> spawns_;
+    PODVector<unsigned> kills_; // Boid index and killer node pairs
+    int score_ = 0;
+    bool hasScore_ = false;
+};
+
+void ReadGameEvents(MemoryBuffer& source, PODVector<GameEvent>& events);
+
+// Server side: one reliable MSG_GAMEEVENTS message per connection per network update, when it has anything queued
+class GameEventServer {
+public:
+    unsigned long long eventsQueued = 0;
+    unsigned long long eventsMerged = 0;
+    unsigned long long messagesSent = 0;
+    NetStats* stats = nullptr;
+
+    // Methods
+    void Spawn(Connection* connection, unsigned nodeID);
+    void Score(Connection* connection, int score);
+    void Kill(const Vector<SharedPtr<Connection> >& connections, unsigned boidIndex, unsigned killerID);
+    void Send(const Vector<SharedPtr<Connection> >& connections);
+    void RemoveConnection(Connection* connection) { batches_.Erase(connection); }
+    unsigned GetMemoryUse() const;
+
+private:
+    HashMap<Connection*, GameEventBatch> batches_;
+    VectorBuffer message_;
+};
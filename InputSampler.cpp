@@ -0,0 +1,95 @@
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Engine/EngineEvents.h>
+#include <Urho3D/Input/Input.h>
+#include <Urho3D/Input/InputEvents.h>
+#include <Urho3D/IO/Log.h>
+
+#include "InputSampler.h"
+#include "LoadTest.h"
+#include "Player.h"
+
+static const int ButtonKeys[][2] = {
+    { CTRL_FORWARD, KEY_W },
+    { CTRL_BACK, KEY_S },
+    { CTRL_LEFT, KEY_A },
+    { CTRL_RIGHT, KEY_D }
+};
+
+InputSampler::InputSampler(Context* context) : Object(context) {
+    SubscribeToEvent(E_INPUTEND, URHO3D_HANDLER(InputSampler, HandleInputEnd));
+}
+
+Controls InputSampler::Take(float& sampleTime) {
+    Controls controls;
+    controls.buttons_ = held_ | pressed_;
+    controls.yaw_ = yaw_;
+    controls.pitch_ = pitch_;
+    sampleTime = sampleTime_;
+
+    yaw_ = pitch_ = 0.0f;
+    pressed_ = 0;
+    sampleTime_ = -1.0f;
+    return controls;
+}
+
+void InputSampler::HandleInputEnd(StringHash eventType, VariantMap& eventData) {
+    Input* input = GetSubsystem<Input>();
+
+    IntVector2 move = input->GetMouseMove();
+    yaw_ += move.x_;
+    pitch_ += move.y_;
+
+    held_ = 0;
+    for (unsigned i = 0; i < sizeof(ButtonKeys) / sizeof(ButtonKeys[0]); i++) {
+        if (input->GetKeyDown(ButtonKeys[i][1])) held_ |= ButtonKeys[i][0];
+    }
+    pressed_ |= held_;
+
+    if (sampleTime_ < 0.0f && (held_ || move != IntVector2::ZERO)) {
+        InputLatency* latency = GetSubsystem<InputLatency>();
+        if (latency) sampleTime_ = latency->Now();
+    }
+}
+
+InputLatency::InputLatency(Context* context) : Object(context) {
+    SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(InputLatency, HandleEndFrame));
+    SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(InputLatency, HandleUpdate));
+    SubscribeToEvent(E_CONSOLECOMMAND, URHO3D_HANDLER(InputLatency, HandleConsoleCommand));
+}
+
+void InputLatency::LogReport() {
+    if (visible_.Empty() && applied_.Empty()) {
+        URHO3D_LOGINFO("Input latency: no samples");
+        return;
+    }
+
+    URHO3D_LOGINFOF("Input latency: visible p50 %.1f ms, p95 %.1f ms, p99 %.1f ms (%u); server apply p50 %.1f ms, "
+        "p95 %.1f ms, p99 %.1f ms (%u)", Percentile(visible_, 0.5f), Percentile(visible_, 0.95f), Percentile(visible_, 0.99f),
+        visible_.Size(), Percentile(applied_, 0.5f), Percentile(applied_, 0.95f), Percentile(applied_, 0.99f), applied_.Size());
+}
+
+void InputLatency::HandleEndFrame(StringHash eventType, VariantMap& eventData) {
+    // The predicted response to these inputs was rendered this frame
+    float now = Now();
+    for (unsigned i = 0; i < predicted_.Size(); i++) visible_.Push(now - predicted_[i]);
+    predicted_.Clear();
+}
+
+void InputLatency::HandleUpdate(StringHash eventType, VariantMap& eventData) {
+    using namespace Update;
+
+    reportTimer_ += eventData[P_TIMESTEP].GetFloat();
+    if (reportTimer_ < reportInterval) return;
+
+    if (!visible_.Empty() || !applied_.Empty()) LogReport();
+    visible_.Clear();
+    applied_.Clear();
+    reportTimer_ = 0.0f;
+}
+
+void InputLatency::HandleConsoleCommand(StringHash eventType, VariantMap& eventData) {
+    using namespace ConsoleCommand;
+
+    if (eventData[P_ID].GetString() != GetTypeName()) return;
+    if (eventData[P_COMMAND].GetString().Trimmed() == "inputlatency") LogReport();
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Input/Controls.h>
+
+using namespace Urho3D;
+
+// Client side: samples the keyboard and mouse every frame rather than once per physics step. Mouse movement is summed
+// until the next step takes it, so none is lost or applied twice when frames and steps do not line up, and a key
+// counts as held for a step if it was down in any frame since the previous one, so short taps are not dropped.
+class InputSampler : public Object {
+    URHO3D_OBJECT(InputSampler, Object);
+
+public:
+    // Methods
+    InputSampler(Context* context);
+    Controls Take(float& sampleTime); // sampleTime is when the oldest input in it was read, -1 when there was none
+
+private:
+    float yaw_ = 0.0f;
+    float pitch_ = 0.0f;
+    unsigned held_ = 0; // Down in the latest frame
+    unsigned pressed_ = 0; // Down in any frame since the last Take
+    float sampleTime_ = -1.0f;
+
+    void HandleInputEnd(StringHash eventType, VariantMap& eventData);
+};
+
+// Subsystem measuring how long player input takes, from the frame it was read in, to show on screen through local
+// prediction and to be applied by the server. Percentiles are logged every reportInterval seconds while there are
+// samples, and by the "inputlatency" console command.
+class InputLatency : public Object {
+    URHO3D_OBJECT(InputLatency, Object);
+
+public:
+    float reportInterval = 10.0f;
+
+    // Methods
+    InputLatency(Context* context);
+    float Now() { return clock_.GetUSec(false) / 1000.0f; } // Milliseconds
+    void Predicted(float sampleTime) { predicted_.Push(sampleTime); }
+    void Applied(float latency) { applied_.Push(latency); }
+    void LogReport();
+
+private:
+    HiresTimer clock_;
+    PODVector<float> predicted_; // Sample times predicted this frame, visible once it ends
+    PODVector<float> visible_;
+    PODVector<float> applied_;
+    float reportTimer_ = 0.0f;
+
+    void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+    void HandleUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleConsoleCommand(StringHash eventType, VariantMap& eventData);
+};
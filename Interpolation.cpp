@@ -0,0 +1,142 @@
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+#include "Interpolation.h"
+
+void InterpolationBuffer::Push(const TransformSample& sample) {
+    // Samples arriving in the same frame replace each other rather than making a zero-length segment
+    if (!samples_.Empty() && sample.time <= samples_.Back().time) {
+        samples_.Back() = sample;
+        return;
+    }
+
+    if (samples_.Size() >= InterpolationSamples) samples_.Erase(0);
+    samples_.Push(sample);
+}
+
+bool InterpolationBuffer::Sample(float time, float maxExtrapolation, Vector3& position, Quaternion& rotation) const {
+    if (samples_.Empty()) return false;
+
+    const TransformSample& first = samples_.Front();
+    const TransformSample& last = samples_.Back();
+
+    if (time <= first.time) {
+        position = first.position;
+        rotation = first.rotation;
+        return true;
+    }
+
+    // Nothing newer has arrived: carry on along the last velocity, but not indefinitely
+    if (time >= last.time) {
+        position = last.position + last.velocity * Min(time - last.time, maxExtrapolation);
+        rotation = last.rotation;
+        return true;
+    }
+
+    unsigned i = samples_.Size() - 1;
+    while (samples_[i - 1].time > time) i--;
+
+    const TransformSample& a = samples_[i - 1];
+    const TransformSample& b = samples_[i];
+    float dt = b.time - a.time;
+    float s = (time - a.time) / dt;
+    float s2 = s * s;
+    float s3 = s2 * s;
+
+    // Cubic Hermite basis, velocities scaled by the segment length to become tangents
+    float h00 = 2.0f * s3 - 3.0f * s2 + 1.0f;
+    float h10 = s3 - 2.0f * s2 + s;
+    float h01 = -2.0f * s3 + 3.0f * s2;
+    float h11 = s3 - s2;
+
+    position = a.position * h00 + a.velocity * (h10 * dt) + b.position * h01 + b.velocity * (h11 * dt);
+    rotation = a.rotation.Slerp(b.rotation, s);
+    return true;
+}
+
+RemotePlayers::RemotePlayers(Context* context, Scene* pScene) : Object(context), scene_(pScene) {
+    SubscribeToEvent(E_INTERCEPTNETWORKUPDATE, URHO3D_HANDLER(RemotePlayers, HandleInterceptNetworkUpdate));
+}
+
+void RemotePlayers::Update(float time) {
+    if (!scene_) return;
+
+    // Replicated nodes get their name after they are created, so new players are picked up here rather than on NodeAdded
+    scene_->GetChildren(children_);
+    for (unsigned i = 0; i < children_.Size(); i++) {
+        Node* node = children_[i];
+        if (node->IsReplicated() && node->GetName() == "Player" && node->GetID() != localNodeID_ && !players_.Contains(node->GetID()))
+            AddPlayer(node);
+    }
+
+    Vector3 position;
+    Quaternion rotation;
+
+    for (HashMap<unsigned, RemotePlayer>::Iterator i = players_.Begin(); i != players_.End();) {
+        RemotePlayer& player = i->second_;
+
+        if (!player.node) {
+            i = players_.Erase(i);
+            continue;
+        }
+
+        if (player.received) {
+            player.buffer.Push(player.latest);
+            player.received = false;
+        }
+
+        if (player.buffer.Sample(time - playoutDelay, maxExtrapolation, position, rotation)) player.node->SetTransform(position, rotation);
+        ++i;
+    }
+}
+
+void RemotePlayers::AddPlayer(Node* node) {
+    RemotePlayer& player = players_[node->GetID()];
+    player.node = node;
+    player.latest.time = 0.0f;
+    player.latest.position = node->GetPosition();
+    player.latest.rotation = node->GetRotation();
+    player.latest.velocity = Vector3::ZERO;
+
+    node->SetInterceptNetworkUpdate("Network Position", true);
+    node->SetInterceptNetworkUpdate("Network Rotation", true);
+
+    // The node is driven from the buffer, so the local physics must follow it instead of simulating it
+    RigidBody* body = node->GetComponent<RigidBody>();
+    if (body) {
+        body->SetInterceptNetworkUpdate("Linear Velocity", true);
+        body->SetKinematic(true);
+    }
+}
+
+void RemotePlayers::HandleInterceptNetworkUpdate(StringHash eventType, VariantMap& eventData) {
+    using namespace InterceptNetworkUpdate;
+
+    Serializable* serializable = static_cast<Serializable*>(eventData[P_SERIALIZABLE].GetPtr());
+    Node* node = dynamic_cast<Node*>(serializable);
+    if (!node) {
+        Component* component = dynamic_cast<Component*>(serializable);
+        node = component ? component->GetNode() : nullptr;
+    }
+    if (!node) return;
+
+    HashMap<unsigned, RemotePlayer>::Iterator i = players_.Find(node->GetID());
+    if (i == players_.End()) return;
+
+    RemotePlayer& player = i->second_;
+    const String& name = eventData[P_NAME].GetString();
+    const Variant& value = eventData[P_VALUE];
+
+    if (name == "Network Position") player.latest.position = value.GetVector3();
+    else if (name == "Network Rotation") {
+        MemoryBuffer buffer(value.GetBuffer());
+        player.latest.rotation = buffer.ReadPackedQuaternion();
+    } else if (name == "Linear Velocity") player.latest.velocity = value.GetVector3();
+
+    // All attributes of one update arrive in the same frame, so they are pushed together on the next Update
+    player.latest.time = GetSubsystem<Time>()->GetElapsedTime();
+    player.received = true;
+}
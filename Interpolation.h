@@ -0,0 +1,68 @@
+#pragma once
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Math/Quaternion.h>
+#include <Urho3D/Scene/Node.h>
+
+namespace Urho3D {
+    class Scene;
+}
+
+using namespace Urho3D;
+
+const static unsigned InterpolationSamples = 8; // Samples kept per entity, covers the playout delay with room to spare
+
+// One received state of a remote entity, stamped with the local time it arrived
+struct TransformSample {
+    float time;
+    Vector3 position;
+    Vector3 velocity;
+    Quaternion rotation;
+};
+
+// Playout buffer for one remote entity. Positions between two samples are Hermite interpolated using the sampled
+// velocities as tangents; past the newest sample they are extrapolated along its velocity for a bounded time.
+class InterpolationBuffer {
+public:
+    void Push(const TransformSample& sample);
+    bool Sample(float time, float maxExtrapolation, Vector3& position, Quaternion& rotation) const;
+    void Clear() { samples_.Clear(); }
+    bool Empty() const { return samples_.Empty(); }
+    unsigned GetMemoryUse() const { return sizeof(InterpolationBuffer) + samples_.Capacity() * sizeof(TransformSample); }
+
+private:
+    PODVector<TransformSample> samples_; // Oldest first
+};
+
+// Client side: intercepts the replicated transform and velocity of remote player nodes instead of letting Urho apply
+// them directly, and plays them out with the same delay as the boid snapshots
+class RemotePlayers : public Object {
+    URHO3D_OBJECT(RemotePlayers, Object);
+
+public:
+    float playoutDelay = 0.1f;
+    float maxExtrapolation = 0.25f;
+
+    // Methods
+    RemotePlayers(Context* context, Scene* pScene);
+    void Update(float time);
+    void Clear() { players_.Clear(); }
+    void SetLocalPlayer(unsigned nodeID) { localNodeID_ = nodeID; players_.Erase(nodeID); } // Predicted, not played out
+
+private:
+    struct RemotePlayer {
+        WeakPtr<Node> node;
+        InterpolationBuffer buffer;
+        TransformSample latest;
+        bool received = false;
+    };
+
+    WeakPtr<Scene> scene_;
+    unsigned localNodeID_ = 0;
+    HashMap<unsigned, RemotePlayer> players_; // By node ID
+    PODVector<Node*> children_;
+
+    void AddPlayer(Node* node);
+    void HandleInterceptNetworkUpdate(StringHash eventType, VariantMap& eventData);
+};
@@ -0,0 +1,135 @@
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Network/Network.h>
+
+#include "LoadTest.h"
+#include "Player.h"
+
+Controls BotControls::Next(float timeStep) {
+    changeTimer_ -= timeStep;
+    if (changeTimer_ <= 0.0f) {
+        changeTimer_ = Random(1.0f, 4.0f);
+
+        buttons_ = Random(10) < 8 ? CTRL_FORWARD : 0;
+        if (Random(4) == 0) buttons_ |= Random(2) ? CTRL_LEFT : CTRL_RIGHT;
+        yawRate_ = Random(-90.0f, 90.0f);
+        pitchRate_ = Random(-10.0f, 10.0f);
+    }
+
+    // Mouse movement per step, the same units ApplyControls expects
+    Controls controls;
+    controls.buttons_ = buttons_;
+    controls.yaw_ = yawRate_ * timeStep;
+    controls.pitch_ = pitchRate_ * timeStep;
+    return controls;
+}
+
+float Percentile(PODVector<float>& values, float fraction) {
+    if (values.Empty()) return 0.0f;
+
+    Sort(values.Begin(), values.End());
+    return values[Min((unsigned)(fraction * values.Size()), values.Size() - 1)];
+}
+
+LoadTest::LoadTest(Context* context) : Object(context) {}
+
+void LoadTest::Start(unsigned numBots, unsigned short port) {
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+
+    // Bots are further copies of this executable, started in bot mode
+    program_ = fileSystem->GetProgramDir() + APP_EXECUTABLE;
+#ifdef _WIN32
+    program_ += ".exe";
+#endif
+    port_ = port;
+    numBots_ = Clamp(numBots, 1U, MaxBots);
+
+    SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(LoadTest, HandleBeginFrame));
+    SubscribeToEvent(E_POSTRENDERUPDATE, URHO3D_HANDLER(LoadTest, HandlePostRenderUpdate));
+    URHO3D_LOGINFOF("Load test: ramping up to %u bots at %u per second", numBots_, spawnRate);
+}
+
+void LoadTest::SpawnBot() {
+    Vector<String> arguments;
+    arguments.Push("-bot");
+    arguments.Push("-port");
+    arguments.Push(String(port_));
+    arguments.Push("-seed");
+    arguments.Push(String(numSpawned_ + 1));
+    if (spectators) arguments.Push("-spectate");
+
+    if (GetSubsystem<FileSystem>()->SystemSpawn(program_, arguments) < 0) URHO3D_LOGERRORF("Load test: failed to start %s", program_.CString());
+    numSpawned_++;
+}
+
+void LoadTest::Report(const Vector<SharedPtr<Connection> >& connections) {
+    float tickMean = 0.0f;
+    for (unsigned i = 0; i < tickTimes_.Size(); i++) tickMean += tickTimes_[i];
+    if (!tickTimes_.Empty()) tickMean /= tickTimes_.Size();
+
+    float bytesMean = 0.0f;
+    for (unsigned i = 0; i < bytesOut_.Size(); i++) bytesMean += bytesOut_[i];
+    if (!bytesOut_.Empty()) bytesMean /= bytesOut_.Size();
+
+    float tickP99 = Percentile(tickTimes_, 0.99f);
+    float tickMax = tickTimes_.Empty() ? 0.0f : tickTimes_.Back();
+
+    URHO3D_LOGINFOF("Load test: %u bots, tick mean %.2f ms, p99 %.2f ms, max %.2f ms%s; %.0f bytes out per client per second; "
+        "RTT p50 %.0f ms, p95 %.0f ms, p99 %.0f ms", connections.Size(), tickMean, tickP99, tickMax,
+        tickP99 > tickBudget ? " (over budget)" : "", bytesMean, Percentile(roundTrips_, 0.5f),
+        Percentile(roundTrips_, 0.95f), Percentile(roundTrips_, 0.99f));
+
+    tickTimes_.Clear();
+    roundTrips_.Clear();
+    bytesOut_.Clear();
+}
+
+void LoadTest::HandleBeginFrame(StringHash eventType, VariantMap& eventData) {
+    tickTimer_.Reset();
+}
+
+void LoadTest::HandlePostRenderUpdate(StringHash eventType, VariantMap& eventData) {
+    using namespace PostRenderUpdate;
+
+    // Begin frame to here covers receiving, simulation and sending, but not the frame limiter's sleep
+    tickTimes_.Push(tickTimer_.GetUSec(false) / 1000.0f);
+
+    if (finished_) return;
+
+    float timeStep = eventData[P_TIMESTEP].GetFloat();
+    const Vector<SharedPtr<Connection> >& connections = GetSubsystem<Network>()->GetClientConnections();
+
+    spawnTimer_ += timeStep;
+    while (numSpawned_ < numBots_ && spawnTimer_ >= 1.0f / spawnRate) {
+        spawnTimer_ -= 1.0f / spawnRate;
+        SpawnBot();
+    }
+
+    sampleTimer_ += timeStep;
+    if (sampleTimer_ >= 1.0f) {
+        for (unsigned i = 0; i < connections.Size(); i++) {
+            roundTrips_.Push(connections[i]->GetRoundTripTime());
+            bytesOut_.Push(connections[i]->GetBytesOutPerSec());
+        }
+        sampleTimer_ = 0.0f;
+    }
+
+    reportTimer_ += timeStep;
+    if (reportTimer_ >= reportInterval) {
+        Report(connections);
+        reportTimer_ = 0.0f;
+    }
+
+    if (numSpawned_ == numBots_) {
+        holdTimer_ += timeStep;
+        if (holdTimer_ >= holdTime) {
+            Report(connections);
+            URHO3D_LOGINFO("Load test: finished");
+            finished_ = true;
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Input/Controls.h>
+
+namespace Urho3D {
+    class Connection;
+}
+
+using namespace Urho3D;
+
+const static unsigned MaxBots = 256;
+
+float Percentile(PODVector<float>& values, float fraction); // Sorts values
+
+// Randomised stand-in for a player: swims mostly forward and turns in long sweeps, changing its mind every few seconds
+class BotControls {
+public:
+    Controls Next(float timeStep);
+
+private:
+    unsigned buttons_ = 0;
+    float yawRate_ = 0.0f;
+    float pitchRate_ = 0.0f;
+    float changeTimer_ = 0.0f;
+};
+
+// Runs alongside a dedicated server: spawns bot processes against it over loopback, ramping up a few per second, and
+// logs the server's tick time, per-client bandwidth and round trip time percentiles at each step of the ramp
+class LoadTest : public Object {
+    URHO3D_OBJECT(LoadTest, Object);
+
+public:
+    unsigned spawnRate = 4; // Bots started per second
+    float reportInterval = 5.0f;
+    float holdTime = 30.0f; // How long to keep running once every bot has been started
+    float tickBudget = 1000.0f / 60.0f; // Milliseconds, ticks beyond this mean the server can no longer keep up
+    bool spectators = false; // Bots only watch, for load testing a relay
+
+    // Methods
+    LoadTest(Context* context);
+    void Start(unsigned numBots, unsigned short port);
+    bool IsFinished() const { return finished_; }
+
+private:
+    String program_;
+    unsigned short port_ = 0;
+    unsigned numBots_ = 0;
+    unsigned numSpawned_ = 0;
+    float spawnTimer_ = 0.0f;
+    float reportTimer_ = 0.0f;
+    float sampleTimer_ = 0.0f;
+    float holdTimer_ = 0.0f;
+    bool finished_ = false;
+
+    HiresTimer tickTimer_;
+    PODVector<float> tickTimes_; // Milliseconds, this report interval
+    PODVector<float> roundTrips_; // Milliseconds, sampled once a second per connection
+    PODVector<float> bytesOut_; // Per connection per second, sampled with the round trips
+
+    void SpawnBot();
+    void Report(const Vector<SharedPtr<Connection> >& connections);
+    void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+    void HandlePostRenderUpdate(StringHash eventType, VariantMap& eventData);
+};
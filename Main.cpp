@@ -1,5 +1,7 @@
 #include <Urho3D/Core/CoreEvents.h>
 #include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
 #include <Urho3D/Container/Vector.h>
 #include <Urho3D/Engine/Engine.h>
 #include <Urho3D/Graphics/AnimatedModel.h>
@@ -12,10 +14,12 @@
 #include <Urho3D/Graphics/ParticleEmitter.h>
 #include <Urho3D/Graphics/Renderer.h>
 #include <Urho3D/Graphics/Skybox.h>
+#include <Urho3D/Graphics/Texture2D.h>
 #include <Urho3D/Graphics/Zone.h>
 #include <Urho3D/Input/Controls.h>
 #include <Urho3D/Input/Input.h>
 #include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
 #include <Urho3D/Network/Connection.h>
 #include <Urho3D/Network/Network.h>
 #include <Urho3D/Network/NetworkEvents.h>
@@ -36,18 +40,24 @@
 
 #include "Main.h"
 #include "Boids.h"
+#include "Messages.h"
+#include "NetStats.h"
+#include "PackageLoader.h"
 
 static const StringHash PLAYER_ID("IDENTITY");
-static const StringHash PLAYER_SCORE("SCORE");
-static const StringHash E_CLIENTOBJECTAUTHORITY("ClientObjectAuthority");
 static const StringHash E_CLIENTISREADY("ClientReadyToStart");
-static const StringHash E_CLIENTSCORECHANGE("ClientScoreIncrease");
 
 URHO3D_DEFINE_APPLICATION_MAIN(Main)
 
+// Output of the 'packages' build target, relative to the program directory
+static const char* RESOURCE_PACKAGES[] = {
+    "CoreData-small.pak", "CoreData-large.pak", "Data-small.pak", "Data-large.pak",
+    "Autoload/LargeData-small.pak", "Autoload/LargeData-large.pak"
+};
+static const unsigned NUM_RESOURCE_PACKAGES = sizeof(RESOURCE_PACKAGES) / sizeof(RESOURCE_PACKAGES[0]);
+
 Text* fpsCounter;
 Text* scoreCounter;
-BoidSet boids;
 
 Button* CreateButton(const String& text, int pHeight, Font* font, Urho3D::Window* window) {
     Button* button = window->CreateChild<Button>();
@@ -78,11 +88,101 @@ LineEdit* CreateLineEdit(const String& text, int pHeight, Urho3D::Window* window
     return lineEdit;
 }
 
-Main::Main(Context* context) : Sample(context) {}
+Main::Main(Context* context) : Sample(context), serverPort_(SERVER_PORT), numBoids_(NumBoids) {}
 Main::~Main() {}
 
+void Main::Setup() {
+    Sample::Setup();
+
+    const Vector<String>& arguments = GetArguments();
+    for (unsigned i = 0; i < arguments.Size(); ++i) {
+        String argument = arguments[i].ToLower();
+
+        if (argument == "-jpgtextures") useCompressedTextures_ = false;
+        else if (argument == "-texturereport") textureReport_ = true;
+        else if (argument == "-packages") usePackages_ = true;
+        else if (argument == "-boids" && i + 1 < arguments.Size()) numBoids_ = Max(ToInt(arguments[++i]), 0);
+        else if (argument == "-arenas" && i + 1 < arguments.Size()) numArenas_ = Max(ToUInt(arguments[++i]), 1U);
+        else if (argument == "-arenaplayers" && i + 1 < arguments.Size()) arenaCapacity_ = Max(ToUInt(arguments[++i]), 1U);
+        else if (argument == "-checkpoint" && i + 1 < arguments.Size()) checkpointPath_ = arguments[++i];
+        else if (argument == "-server" || argument == "-headless") headless_ = true;
+        else if (argument == "-bot") bot_ = headless_ = true;
+        else if (argument == "-spectate") spectate_ = true;
+        else if (argument == "-relay" && i + 1 < arguments.Size()) {
+            // host[:port] of the game server, the relay itself listens on -port
+            Vector<String> address = arguments[++i].Split(':');
+            relayAddress_ = address[0];
+            if (address.Size() > 1) relayPort_ = (unsigned short)ToUInt(address[1]);
+            relay_ = headless_ = true;
+        }
+        else if (argument == "-loadtest" && i + 1 < arguments.Size()) {
+            loadTestBots_ = Clamp(ToUInt(arguments[++i]), 1U, MaxBots);
+            headless_ = true;
+        }
+        else if (argument == "-seed" && i + 1 < arguments.Size()) SetRandomSeed(ToUInt(arguments[++i]));
+        else if (argument == "-port" && i + 1 < arguments.Size()) serverPort_ = (unsigned short)ToUInt(arguments[++i]);
+        else if (argument == "-netfps" && i + 1 < arguments.Size()) networkUpdateFps_ = Clamp(ToInt(arguments[++i]), 1, 60);
+        else if (argument == "-profilecsv" && i + 1 < arguments.Size()) profileCsvPath_ = arguments[++i];
+        else if (argument == "-telemetry" && i + 1 < arguments.Size()) telemetryPath_ = arguments[++i];
+        else if (argument == "-telemetryinterval" && i + 1 < arguments.Size()) telemetryInterval_ = Max(ToFloat(arguments[++i]), 0.1f);
+        else if (argument == "-flocktest" && i + 1 < arguments.Size()) {
+            flockTestPath_ = arguments[++i];
+            headless_ = true;
+        }
+        else if (argument == "-flocktestsave") saveFlockBaseline_ = true;
+        else if (argument == "-wakeradius" && i + 1 < arguments.Size()) wakeRadius_ = Max(ToFloat(arguments[++i]), 0.0f);
+        else if (argument == "-playoutdelay" && i + 1 < arguments.Size()) playoutDelay_ = Max(ToInt(arguments[++i]), 0) / 1000.0f;
+    }
+
+    if (headless_) {
+        engineParameters_["Headless"] = true;
+        engineParameters_["Sound"] = false;
+    }
+    if (bot_) {
+        // Hundreds of bots would otherwise share one log file
+        engineParameters_["LogName"] = "";
+        engineParameters_["LogQuiet"] = true;
+    }
+
+    if (usePackages_) {
+        FileSystem* fileSystem = GetSubsystem<FileSystem>();
+
+        if (fileSystem->FileExists(fileSystem->GetProgramDir() + RESOURCE_PACKAGES[0])) {
+            // Packages replace the loose Data and CoreData directories, the Autoload ones are picked up by the engine
+            engineParameters_["ResourcePaths"] = "";
+            engineParameters_["ResourcePackages"] = "CoreData-small.pak;CoreData-large.pak;Data-small.pak;Data-large.pak";
+        } else {
+            usePackages_ = false;
+        }
+    }
+}
 void Main::Start() {
+    CreateStats();
+    playerToken_ = CreatePlayerToken();
+
+    if (!flockTestPath_.Empty()) {
+        RunFlockTest();
+        return;
+    }
+    if (bot_) {
+        StartBot();
+        return;
+    }
+    if (relay_) {
+        StartRelay();
+        return;
+    }
+    if (headless_) {
+        StartDedicatedServer();
+        return;
+    }
+
     Sample::Start();
+
+    if (usePackages_) MapResourcePackages();
+    if (useCompressedTextures_) AddCompressedTextures();
+    if (textureReport_) ReportTextureLoadTimes();
+
     CreateMainMenu();
 }
 void Main::SubscribeToEvents() {
@@ -92,13 +192,175 @@ void Main::SubscribeToEvents() {
     SubscribeToEvent(E_CLIENTDISCONNECTED, URHO3D_HANDLER(Main, HandleClientDisconnected));
 
     SubscribeToEvent(E_SERVERDISCONNECTED, URHO3D_HANDLER(Main, HandleServerDisconnected));
+    SubscribeToEvent(E_NETWORKMESSAGE, URHO3D_HANDLER(Main, HandleNetworkMessage));
+    SubscribeToEvent(E_NETWORKUPDATE, URHO3D_HANDLER(Main, HandleNetworkUpdate));
 
     SubscribeToEvent(E_CLIENTISREADY, URHO3D_HANDLER(Main, HandleClientToServerReadyToStart));
     GetSubsystem<Network>()->RegisterRemoteEvent(E_CLIENTISREADY);
-    SubscribeToEvent(E_CLIENTOBJECTAUTHORITY, URHO3D_HANDLER(Main, HandleServerToClientObjectID));
-    GetSubsystem<Network>()->RegisterRemoteEvent(E_CLIENTOBJECTAUTHORITY);
-    SubscribeToEvent(E_CLIENTSCORECHANGE, URHO3D_HANDLER(Main, HandleServerToClientScoreIncreased));
-    GetSubsystem<Network>()->RegisterRemoteEvent(E_CLIENTSCORECHANGE);
+}
+
+void Main::AddCompressedTextures() {
+    // Output of the 'textures' build target, takes priority over the JPG materials in Autoload
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    String path = fileSystem->GetProgramDir() + "CompressedData";
+
+    if (fileSystem->DirExists(path)) GetSubsystem<ResourceCache>()->AddResourceDir(path, 0);
+}
+void Main::MapResourcePackages() {
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    PackageLoader* loader = new PackageLoader(context_);
+    context_->RegisterSubsystem(loader);
+
+    for (unsigned i = 0; i < NUM_RESOURCE_PACKAGES; i++) {
+        String path = fileSystem->GetProgramDir() + RESOURCE_PACKAGES[i];
+        if (fileSystem->FileExists(path)) loader->AddPackage(path);
+    }
+}
+void Main::CreateStats() {
+    NetStats* stats = new NetStats(context_);
+    context_->RegisterSubsystem(stats);
+    gameEvents_.stats = stats;
+
+    FrameProfiler* profiler = new FrameProfiler(context_);
+    profiler->csvPath = profileCsvPath_;
+    context_->RegisterSubsystem(profiler);
+
+    context_->RegisterSubsystem(new TickScratch(context_));
+
+    MemoryReport* memory = new MemoryReport(context_);
+    memory->arenas = &arenas_;
+    memory->snapshotClient = &snapshotClient_;
+    memory->relaySnapshots = &relaySnapshots_;
+    memory->gameEvents = &gameEvents_;
+    context_->RegisterSubsystem(memory);
+
+    InputLatency* latency = new InputLatency(context_);
+    context_->RegisterSubsystem(latency);
+    predictor_.latency = latency;
+
+    if (!telemetryPath_.Empty()) {
+        Telemetry* telemetry = new Telemetry(context_);
+        telemetry->interval = telemetryInterval_;
+        telemetry->Start(telemetryPath_);
+        context_->RegisterSubsystem(telemetry);
+    }
+}
+void Main::ReportTextureLoadTimes() {
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    const Vector<String>& resourceDirs = cache->GetResourceDirs();
+    Vector<String> materials;
+
+    for (unsigned i = 0; i < resourceDirs.Size(); ++i) {
+        Vector<String> files;
+        fileSystem->ScanDir(files, resourceDirs[i] + "Materials/PBR", "*.xml", SCAN_FILES, false);
+
+        for (unsigned j = 0; j < files.Size(); ++j) {
+            if (!materials.Contains(files[j])) materials.Push(files[j]);
+        }
+    }
+
+    HiresTimer timer;
+    long long total = 0;
+
+    for (unsigned i = 0; i < materials.Size(); ++i) {
+        timer.Reset();
+        cache->GetResource<Material>("Materials/PBR/" + materials[i]);
+        long long elapsed = timer.GetUSec(false);
+        total += elapsed;
+
+        URHO3D_LOGINFOF("Texture report: %s loaded in %.2f ms", materials[i].CString(), elapsed / 1000.0f);
+    }
+
+    URHO3D_LOGINFOF("Texture report (%s): %u materials in %.2f ms, %u KB texture memory",
+        useCompressedTextures_ ? "dds" : "jpg", materials.Size(), total / 1000.0f,
+        (unsigned)(cache->GetMemoryUse(Texture2D::GetTypeStatic()) / 1024));
+}
+
+bool Main::StartServer() {
+    // Clients interpolate between snapshots, so the server only has to send them at a fraction of the physics rate
+    Network* network = GetSubsystem<Network>();
+    network->SetUpdateFps(networkUpdateFps_);
+    return network->StartServer(serverPort_);
+}
+void Main::StartDedicatedServer() {
+    // No window, UI or audio; the server only has to simulate and replicate
+    engine_->SetMaxFps(60);
+
+    SubscribeToEvents();
+    CreateGameScene();
+
+    if (!StartServer()) {
+        URHO3D_LOGERRORF("Failed to start server on port %d", serverPort_);
+        engine_->Exit();
+        return;
+    }
+
+    CreateServerObjects();
+    URHO3D_LOGINFOF("Dedicated server listening on port %d", serverPort_);
+
+    if (loadTestBots_ > 0) {
+        loadTest_ = new LoadTest(context_);
+        loadTest_->Start(loadTestBots_, serverPort_);
+    }
+}
+void Main::RunFlockTest() {
+    // Runs to completion here, the exit code tells a CI job whether it passed
+    SharedPtr<FlockTest> test(new FlockTest(context_));
+    test->saveBaseline = saveFlockBaseline_;
+
+    if (test->Run(flockTestPath_)) engine_->Exit();
+    else ErrorExit("Flock regression test failed");
+}
+void Main::StartBot() {
+    // A headless client driven by random controls, started by the load test
+    engine_->SetMaxFps(60);
+
+    SubscribeToEvents();
+    CreateGameScene();
+    snapshotClient_.display = false;
+
+    if (!spectate_) SubscribeToEvent(E_SERVERCONNECTED, URHO3D_HANDLER(Main, HandleClientStartGame));
+    SubscribeToEvent(E_CONNECTFAILED, URHO3D_HANDLER(Main, HandleQuit));
+    VariantMap identity;
+    identity[PLAYER_TOKEN] = playerToken_;
+
+    connectTime_ = GetSubsystem<Time>()->GetElapsedTime();
+    GetSubsystem<Network>()->Connect("localhost", serverPort_, scene_, identity);
+}
+void Main::StartRelay() {
+    // A headless process connected once to the game server as a spectator, re-broadcasting the match to any number of
+    // read-only spectators, so watching costs the game server a single connection
+    engine_->SetMaxFps(60);
+
+    SubscribeToEvents();
+    CreateGameScene();
+    snapshotClient_.display = false;
+    relaySnapshots_.stats = GetSubsystem<NetStats>();
+
+    // Player nodes take the server's state as it arrives and are replicated on to the spectators, who interpolate
+    remotePlayers_ = new RemotePlayers(context_, scene_);
+    remotePlayers_->playoutDelay = 0.0f;
+
+    if (!StartServer()) {
+        URHO3D_LOGERRORF("Failed to start relay on port %d", serverPort_);
+        engine_->Exit();
+        return;
+    }
+
+    VariantMap identity;
+    identity[SPECTATOR_RELAY] = true;
+
+    SubscribeToEvent(E_CONNECTFAILED, URHO3D_HANDLER(Main, HandleQuit));
+    connectTime_ = GetSubsystem<Time>()->GetElapsedTime();
+    GetSubsystem<Network>()->Connect(relayAddress_, relayPort_, scene_, identity);
+    URHO3D_LOGINFOF("Relaying %s:%d to spectators on port %d", relayAddress_.CString(), relayPort_, serverPort_);
+
+    if (loadTestBots_ > 0) {
+        loadTest_ = new LoadTest(context_);
+        loadTest_->spectators = true;
+        loadTest_->Start(loadTestBots_, serverPort_);
+    }
 }
 
 void Main::CreateMainMenu() {
@@ -122,10 +384,11 @@ void Main::CreateMainMenu() {
     window_->SetName("Window");
     window_->SetStyleAuto();
 
-    Button* connectButton = CreateButton("Connect", 24, font, window_);
+    loadingText_ = CreateText("Loading...", 24, font, window_);
+    connectButton_ = CreateButton("Connect", 24, font, window_);
     serverAddress = CreateLineEdit("localhost", 24, window_);
     Button* disconnectButton = CreateButton("Disconnect", 24, font, window_);
-    Button* startButton = CreateButton("Start Server", 24, font, window_);
+    startButton_ = CreateButton("Start Server", 24, font, window_);
     Button* quitButton = CreateButton("Quit", 24, font, window_);
 
     fps_ = new Window(context_);
@@ -161,22 +424,55 @@ void Main::CreateMainMenu() {
 
     scoreCounter = CreateText("Score: 0", 24, font, hud_);
 
-    SubscribeToEvent(connectButton, E_RELEASED, URHO3D_HANDLER(Main, HandleConnect));
+    SubscribeToEvent(connectButton_, E_RELEASED, URHO3D_HANDLER(Main, HandleConnect));
     SubscribeToEvent(disconnectButton, E_RELEASED, URHO3D_HANDLER(Main, HandleDisconnect));
-    SubscribeToEvent(startButton, E_RELEASED, URHO3D_HANDLER(Main, HandleStartServer));
+    SubscribeToEvent(startButton_, E_RELEASED, URHO3D_HANDLER(Main, HandleStartServer));
     SubscribeToEvent(quitButton, E_RELEASED, URHO3D_HANDLER(Main, HandleQuit));
     SubscribeToEvent(readyButton, E_RELEASED, URHO3D_HANDLER(Main, HandleClientStartGame));
     SubscribeToEvents();
 
+    StartPreload();
+}
+void Main::StartPreload() {
+    // The arena is created once everything in the manifest is cached, the menu keeps rendering meanwhile
+    connectButton_->SetEnabled(false);
+    startButton_->SetEnabled(false);
+
+    preloader_ = new Preloader(context_);
+    preloader_->Start(ArenaManifest, ArenaManifestSize);
+}
+void Main::UpdatePreload() {
+    loadingText_->SetText("Loading " + String(preloader_->GetNumLoaded()) + "/" + String(preloader_->GetNumTotal()));
+    if (!preloader_->IsFinished()) return;
+
+    HiresTimer timer;
     CreateGameScene();
+    URHO3D_LOGINFOF("Preload: game scene created in %.2f ms, interactive after %.2f ms",
+        timer.GetUSec(false) / 1000.0f, preloader_->GetElapsed());
+
+    preloader_.Reset();
+    loadingText_->SetVisible(false);
+    connectButton_->SetEnabled(true);
+    startButton_->SetEnabled(true);
 }
 void Main::CreateGameScene() {
-    Graphics* graphics = GetSubsystem<Graphics>();
     ResourceCache* cache = GetSubsystem<ResourceCache>();
 
-    scene_ = new Scene(context_);
-    scene_->CreateComponent<Octree>(LOCAL);
-    scene_->CreateComponent<PhysicsWorld>(LOCAL);
+    scene_ = CreateArenaScene(context_);
+    GetSubsystem<MemoryReport>()->AddScene(scene_);
+
+    // Everything below only matters to someone watching
+    if (headless_) return;
+
+    Graphics* graphics = GetSubsystem<Graphics>();
+
+    // The floor and walls from CreateArenaScene, so far the scene's only children
+    const Vector<SharedPtr<Node> >& arenaNodes = scene_->GetChildren();
+    for (unsigned i = 0; i < arenaNodes.Size(); i++) {
+        StaticModel* arenaObject = arenaNodes[i]->CreateComponent<StaticModel>(LOCAL);
+        arenaObject->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
+        arenaObject->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
+    }
 
     cameraNode_ = new Node(context_);
     Camera* camera = cameraNode_->CreateComponent<Camera>();
@@ -200,63 +496,6 @@ void Main::CreateGameScene() {
     light->SetShadowCascade(CascadeParameters(10.0f, 50.0f, 200.0f, 0.0f, 0.8f));
     light->SetSpecularIntensity(0.5f);
 
-    Node* floorNode = scene_->CreateChild("Floor", LOCAL);
-    floorNode->SetPosition(Vector3(0.0f, -0.5f, 0.0f));
-    floorNode->SetScale(Vector3(200.0f, 1.0f, 200.0f));
-    StaticModel* floorObject = floorNode->CreateComponent<StaticModel>(LOCAL);
-    floorObject->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-    floorObject->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
-
-    RigidBody* rigidbody = floorNode->CreateComponent<RigidBody>(LOCAL);
-    rigidbody->SetCollisionLayer(2);
-    CollisionShape* shape = floorNode->CreateComponent<CollisionShape>(LOCAL);
-    shape->SetBox(Vector3::ONE);
-
-    Node* wallNode1 = scene_->CreateChild("Wall", LOCAL);
-    wallNode1->SetPosition(Vector3(100.5f, 25.0f, 0.0f));
-    wallNode1->SetScale(Vector3(1.0f, 50.0f, 200.0f));
-    StaticModel* wallObject1 = wallNode1->CreateComponent<StaticModel>(LOCAL);
-    wallObject1->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-    wallObject1->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
-
-    Node* wallNode2 = scene_->CreateChild("Wall", LOCAL);
-    wallNode2->SetPosition(Vector3(-100.5f, 25.0f, 0.0f));
-    wallNode2->SetScale(Vector3(1.0f, 50.0f, 200.0f));
-    StaticModel* wallObject2 = wallNode2->CreateComponent<StaticModel>(LOCAL);
-    wallObject2->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-    wallObject2->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
-
-    Node* wallNode3 = scene_->CreateChild("Wall", LOCAL);
-    wallNode3->SetPosition(Vector3(0.0f, 25.0f, 100.5f));
-    wallNode3->SetScale(Vector3(200.0f, 50.0f, 1.0f));
-    StaticModel* wallObject3 = wallNode3->CreateComponent<StaticModel>(LOCAL);
-    wallObject3->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-    wallObject3->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
-
-    Node* wallNode4 = scene_->CreateChild("Wall", LOCAL);
-    wallNode4->SetPosition(Vector3(0.0f, 25.0f, -100.5f));
-    wallNode4->SetScale(Vector3(200.0f, 50.0f, 1.0f));
-    StaticModel* wallObject4 = wallNode4->CreateComponent<StaticModel>(LOCAL);
-    wallObject4->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-    wallObject4->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
-
-    RigidBody* wallBody1 = wallNode1->CreateComponent<RigidBody>(LOCAL);
-    RigidBody* wallBody2 = wallNode2->CreateComponent<RigidBody>(LOCAL);
-    RigidBody* wallBody3 = wallNode3->CreateComponent<RigidBody>(LOCAL);
-    RigidBody* wallBody4 = wallNode4->CreateComponent<RigidBody>(LOCAL);
-    wallBody1->SetCollisionLayer(2);
-    wallBody2->SetCollisionLayer(2);
-    wallBody3->SetCollisionLayer(2);
-    wallBody4->SetCollisionLayer(2);
-    CollisionShape* wallShape1 = wallNode1->CreateComponent<CollisionShape>(LOCAL);
-    CollisionShape* wallShape2 = wallNode2->CreateComponent<CollisionShape>(LOCAL);
-    CollisionShape* wallShape3 = wallNode3->CreateComponent<CollisionShape>(LOCAL);
-    CollisionShape* wallShape4 = wallNode4->CreateComponent<CollisionShape>(LOCAL);
-    wallShape1->SetBox(Vector3::ONE);
-    wallShape2->SetBox(Vector3::ONE);
-    wallShape3->SetBox(Vector3::ONE);
-    wallShape4->SetBox(Vector3::ONE);
-
     waterNode_ = scene_->CreateChild("Water", LOCAL);
     waterNode_->SetScale(Vector3(2048.0f, 1.0f, 2048.0f));
     waterNode_->SetPosition(Vector3(0.0f, 50.0f, 0.0f));
@@ -305,53 +544,130 @@ void Main::CreateGameScene() {
 void Main::CreateClientObjects() {}
 void Main::CreateServerObjects() {
     ResourceCache* cache = GetSubsystem<ResourceCache>();
-    boids.Initialise(cache, scene_);
+
+    // The first arena is the scene on screen, the others have no visuals. All are stepped from ServerUpdate.
+    arenas_.Clear();
+    for (unsigned i = 0; i < numArenas_; i++) {
+        SharedPtr<Arena> arena(new Arena(i));
+        arena->scene = i == 0 ? scene_.Get() : CreateArenaScene(context_);
+        arena->scene->SetUpdateEnabled(false);
+        // One Bullet step per Scene::Update, ServerUpdate runs the fixed steps itself
+        arena->scene->GetComponent<PhysicsWorld>()->SetFps(ArenaStepRate);
+        arena->scene->GetComponent<PhysicsWorld>()->SetMaxSubSteps(-1);
+        arena->snapshots.stats = GetSubsystem<NetStats>();
+        arena->boids.wakeRadius = wakeRadius_;
+        GetSubsystem<MemoryReport>()->AddScene(arena->scene);
+        arenas_.Push(arena);
+    }
+    stepTime_ = 0.0f;
+
+    if (!checkpointPath_.Empty()) {
+        checkpoint_ = new Checkpoint(context_);
+        checkpoint_->path = checkpointPath_;
+    }
+
+    for (unsigned i = 0; i < arenas_.Size(); i++) {
+        // Checkpoints cover the first arena
+        if (i == 0 && checkpoint_ && checkpoint_->Restore(cache, scene_, arenas_[0]->boids)) continue;
+        arenas_[i]->boids.Initialise(cache, arenas_[i]->scene, numBoids_ / 2, numBoids_ - numBoids_ / 2);
+    }
+
+    if (arenas_.Size() > 1) URHO3D_LOGINFOF("Hosting %u arenas of up to %u players", arenas_.Size(), arenaCapacity_);
 }
-Player* Main::CreateCharacter() {
+Player* Main::CreateCharacter(Scene* pScene) {
     ResourceCache* cache = GetSubsystem<ResourceCache>();
 
     Player* p = new Player();
-    p->Initialise(cache, scene_);
+    p->Initialise(cache, pScene);
 
     return p;
 }
+void Main::CreateBiteEffect(const Vector3& position) {
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+    // Local and self-removing, every peer makes its own from the kill event
+    ParticleEffect* particleEffect = cache->GetResource<ParticleEffect>("Particle/SnowExplosionBig.xml");
+    Node* particleNode = scene_->CreateChild("ParticleEmitter", LOCAL);
+    ParticleEmitter* particleEmitter = particleNode->CreateComponent<ParticleEmitter>(LOCAL);
+    particleEmitter->SetEffect(particleEffect);
+    particleEmitter->SetAutoRemoveMode(REMOVE_NODE);
+    particleNode->SetPosition(position);
+}
 
 void Main::HandlePhysicsPreStep(StringHash eventType, VariantMap& eventData) {
-    using namespace Update;
+    using namespace PhysicsPreStep;
 
     Network* network = GetSubsystem<Network>();
     Connection* serverConnection = network->GetServerConnection();
 
     if (serverConnection) ClientPrePhysics(eventData[P_TIMESTEP].GetFloat());
-    else if (network->IsServerRunning()) ServerPrePhysics(eventData[P_TIMESTEP].GetFloat());
+    else if (network->IsServerRunning()) {
+        // Each arena's world sends its own pre-step
+        PhysicsWorld* world = static_cast<PhysicsWorld*>(eventData[P_WORLD].GetPtr());
+        for (unsigned i = 0; i < arenas_.Size(); i++) {
+            if (arenas_[i]->scene->GetComponent<PhysicsWorld>() == world) ServerPrePhysics(arenas_[i], eventData[P_TIMESTEP].GetFloat());
+        }
+    }
+
+    // Bullet steps the world as soon as the pre-step handlers return
+    GetSubsystem<FrameProfiler>()->BeginPhysicsStep();
 }
 void Main::HandleUpdate(StringHash eventType, VariantMap& eventData) {
     using namespace Update;
 
+    if (preloader_) UpdatePreload();
+
     Network* network = GetSubsystem<Network>();
     Connection* serverConnection = network->GetServerConnection();
 
     if (serverConnection) ClientUpdate(eventData[P_TIMESTEP].GetFloat());
     else if (network->IsServerRunning()) ServerUpdate(eventData[P_TIMESTEP].GetFloat());
+
+    if (loadTest_ && loadTest_->IsFinished()) engine_->Exit();
 }
 void Main::HandleClientConnected(StringHash eventType, VariantMap& eventData) {
     using namespace ClientConnected;
 
     Connection* newConnection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
-    newConnection->SetScene(scene_);
+
+    // Spectators of a relay watch its copy of the match
+    if (relay_) {
+        newConnection->SetScene(scene_);
+        return;
+    }
+
+    Arena* arena = AssignArena(arenas_, arenaCapacity_);
+    if (!arena) return;
+
+    arena->AddConnection(newConnection);
+    connectionArenas_[newConnection] = arena;
 }
 void Main::HandleClientDisconnected(StringHash eventType, VariantMap& eventData) {
     using namespace ClientConnected;
 
     Connection* connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
 
-    Player* playerObject = serverObjects_[connection];
-    if (playerObject) playerObject->pNode->Remove();
+    Arena* arena = GetArena(connection);
+    if (arena) arena->RemoveConnection(connection);
+
+    connectionArenas_.Erase(connection);
+    inputQueues_.Erase(connection);
+    gameEvents_.RemoveConnection(connection);
+    relaySnapshots_.RemoveConnection(connection);
+    GetSubsystem<NetStats>()->RemoveConnection(connection);
 }
 void Main::HandleServerDisconnected(StringHash eventType, VariantMap& eventData) {
     printf("HandleServerDisconnected\n");
 
+    if (bot_ || relay_) {
+        engine_->Exit();
+        return;
+    }
+
     scene_->Clear(true, false);
+    snapshotClient_.Clear();
+    remotePlayers_.Reset();
+    predictor_.Detach();
     clientObjectID_ = 0;
 
     window_->SetVisible(true);
@@ -363,36 +679,161 @@ void Main::HandleServerDisconnected(StringHash eventType, VariantMap& eventData)
     ui->GetCursor()->SetVisible(true);
 }
 
-void Main::HandleServerToClientObjectID(StringHash eventType, VariantMap& eventData) {
-    clientObjectID_ = eventData[PLAYER_ID].GetUInt();
-    ready_->SetVisible(false);
-    hud_->SetVisible(true);
+void Main::HandleNetworkMessage(StringHash eventType, VariantMap& eventData) {
+    using namespace NetworkMessage;
+
+    ProfileScope scope(GetSubsystem<FrameProfiler>(), "Network receive");
+
+    int messageID = eventData[P_MESSAGEID].GetInt();
+    if (messageID == MSG_BOIDSNAPSHOT) {
+        MemoryBuffer message(eventData[P_DATA].GetBuffer());
+        snapshotClient_.Receive(message, GetSubsystem<ResourceCache>(), scene_, GetSubsystem<Time>()->GetElapsedTime());
+    } else if (messageID == MSG_PLAYERSTATE) {
+        MemoryBuffer message(eventData[P_DATA].GetBuffer());
+        Connection* connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+        predictor_.Reconcile(message, connection->GetRoundTripTime() * 0.5f);
+    } else if (messageID == MSG_GAMEEVENTS) {
+        MemoryBuffer message(eventData[P_DATA].GetBuffer());
+        HandleGameEvents(message);
+    } else if (messageID == MSG_JOINSNAPSHOT) {
+        MemoryBuffer message(eventData[P_DATA].GetBuffer());
+        float time = GetSubsystem<Time>()->GetElapsedTime();
+        bool first = snapshotClient_.joinBytes == 0;
+        bool joined = snapshotClient_.joined;
+
+        snapshotClient_.ReceiveJoin(message, GetSubsystem<ResourceCache>(), scene_, time);
+
+        // Ready once the arena parameters are in, the flock streams in behind
+        if (first) URHO3D_LOGINFOF("Join: ready after %.2f s", time - connectTime_);
+        if (!joined && snapshotClient_.joined) {
+            URHO3D_LOGINFOF("Join: flock complete after %.2f s, %u bytes", time - connectTime_, snapshotClient_.joinBytes);
+        }
+    }
+}
+void Main::HandleNetworkUpdate(StringHash eventType, VariantMap& eventData) {
+    Network* network = GetSubsystem<Network>();
+    if (!network->IsServerRunning()) return;
 
-    UI* ui = GetSubsystem<UI>();
-    ui->GetCursor()->SetVisible(false);
+    const Vector<SharedPtr<Connection> >& connections = network->GetClientConnections();
+    for (unsigned i = 0; i < arenas_.Size(); i++) {
+        arenas_[i]->UpdateRelayed();
+        arenas_[i]->snapshots.SetState(arenas_[i]->boids);
+        arenas_[i]->snapshots.Send(arenas_[i]->connections, 1.0f / network->GetUpdateFps());
+    }
+    // A relay re-sends the newest flock from upstream, with its own interest management per spectator
+    if (relay_ && snapshotClient_.GetLatest()) {
+        relaySnapshots_.SetState(*snapshotClient_.GetLatest());
+        relaySnapshots_.Send(connections, 1.0f / network->GetUpdateFps());
+    }
+    gameEvents_.Send(connections);
+
+    // Each client's own player, with the last input applied to it, for reconciling its prediction
+    for (unsigned i = 0; i < connections.Size(); i++) {
+        Arena* arena = GetArena(connections[i]);
+        Player* player = arena ? arena->GetPlayer(connections[i]) : nullptr;
+        if (!player) continue;
+
+        InputQueue& inputs = inputQueues_[connections[i]];
+        WritePlayerState(playerState_, inputs.lastApplied, inputs.GetApplyAge(), *player);
+        connections[i]->SendMessage(MSG_PLAYERSTATE, false, false, playerState_);
+        GetSubsystem<NetStats>()->Count(connections[i], NET_PLAYERSTATE, playerState_.GetSize());
+    }
+
+    // Snapshot bandwidth, averaged over the last few seconds
+    snapshotLogTimer_ += 1.0f / network->GetUpdateFps();
+    if (snapshotLogTimer_ >= 5.0f) {
+        unsigned long long bytesSent = 0;
+        for (unsigned i = 0; i < arenas_.Size(); i++) bytesSent += arenas_[i]->snapshots.bytesSent;
+        bytesSent += relaySnapshots_.bytesSent;
+
+        float perClient = connections.Size() ? (float)(bytesSent - snapshotLogBytes_) / connections.Size() / snapshotLogTimer_ : 0.0f;
+        URHO3D_LOGINFOF("Boid snapshots: %.0f bytes per client per second", perClient);
+        URHO3D_LOGINFOF("Game events: %llu queued, %llu merged, %llu messages", gameEvents_.eventsQueued,
+            gameEvents_.eventsMerged, gameEvents_.messagesSent);
+        for (unsigned i = 0; i < connections.Size(); i++) {
+            Arena* arena = GetArena(connections[i]);
+            const SnapshotView* view = arena ? arena->snapshots.GetView(connections[i]) : relaySnapshots_.GetView(connections[i]);
+            if (!view) continue;
+
+            URHO3D_LOGINFOF("Boid snapshots: %s near %u, mid %u, sent %u, quality %u, loss %.0f%%", connections[i]->ToString().CString(),
+                view->numNear, view->numMid, view->numSent, view->rate.level, view->rate.loss * 100.0f);
+        }
+        TickScratch* scratch = GetSubsystem<TickScratch>();
+        URHO3D_LOGINFOF("Tick scratch: %u allocations, %u bytes, %u overflow blocks last tick; %u ticks overflowed since start",
+            scratch->lastTick.allocations, scratch->lastTick.bytes, scratch->lastTick.overflowAllocations, scratch->overflowTicks);
+        if (CountHeapAllocations) {
+            URHO3D_LOGINFOF("Tick heap: %u allocations last tick; %u ticks allocated since start", scratch->lastTick.heapAllocations,
+                scratch->heapTicks);
+        }
+        if (arenas_.Size() > 1 || wakeRadius_ > 0.0f) {
+            for (unsigned i = 0; i < arenas_.Size(); i++) {
+                URHO3D_LOGINFOF("Arena %u: %u connections, %u players, %u/%u regions active, flocking %.2f ms", i, arenas_[i]->connections.Size(),
+                    arenas_[i]->players.Size(), arenas_[i]->boids.numActiveRegions, NumRegions * NumRegions, arenas_[i]->flockTime);
+            }
+        }
+        snapshotLogBytes_ = bytesSent;
+        snapshotLogTimer_ = 0.0f;
+    }
 }
+
 void Main::HandleClientToServerReadyToStart(StringHash eventType, VariantMap& eventData) {
     using namespace ClientConnected;
     Connection* newConnection = static_cast<Connection*>(eventData[P_CONNECTION]. GetPtr());
 
-    Player* newPlayer = CreateCharacter();
-    serverObjects_[newConnection] = newPlayer;
+    Arena* arena = GetArena(newConnection);
+    if (!arena || arena->GetPlayer(newConnection)) return;
 
-    VariantMap remoteEventData;
-    remoteEventData[PLAYER_ID] = newPlayer->pNode->GetID();
-    newConnection->SendRemoteEvent (E_CLIENTOBJECTAUTHORITY, true, remoteEventData);
+    Player* newPlayer = CreateCharacter(arena->scene);
+    newPlayer->SetDistancePriority(!arena->relayed);
+    arena->players[newConnection] = newPlayer;
+
+    gameEvents_.Spawn(newConnection, newPlayer->pNode->GetID());
+
+    // Players reconnecting after a restart get their checkpointed score back
+    if (checkpoint_) newPlayer->score = checkpoint_->TakeScore(newConnection);
+    if (newPlayer->score > 0) gameEvents_.Score(newConnection, newPlayer->score);
 }
-void Main::HandleServerToClientScoreIncreased(StringHash eventType, VariantMap& eventData) {
-    int score = eventData[PLAYER_SCORE].GetInt();
-    scoreCounter->SetText("Score: " + String(score));
+void Main::HandleGameEvents(MemoryBuffer& message) {
+    ReadGameEvents(message, receivedEvents_);
+
+    for (unsigned i = 0; i < receivedEvents_.Size(); i++) {
+        const GameEvent& event = receivedEvents_[i];
+
+        if (event.type == GAME_SPAWN) {
+            clientObjectID_ = event.nodeID;
+            if (headless_) continue;
+
+            ready_->SetVisible(false);
+            hud_->SetVisible(true);
+
+            UI* ui = GetSubsystem<UI>();
+            ui->GetCursor()->SetVisible(false);
+        } else if (event.type == GAME_SCORE) {
+            if (!headless_) scoreCounter->SetText("Score: " + String(event.score));
+        } else if (event.type == GAME_KILL) {
+            if (relay_) gameEvents_.Kill(GetSubsystem<Network>()->GetClientConnections(), event.boidIndex, event.nodeID);
+
+            Node* node = snapshotClient_.Kill(event.boidIndex);
+            if (node) CreateBiteEffect(node->GetPosition());
+        }
+    }
 }
 
 void Main::HandleConnect(StringHash eventType, VariantMap& eventData) {
     CreateClientObjects();
 
+    snapshotClient_.playoutDelay = playoutDelay_;
+    remotePlayers_ = new RemotePlayers(context_, scene_);
+    remotePlayers_->playoutDelay = playoutDelay_;
+    inputSampler_ = new InputSampler(context_);
+
     Network* network = GetSubsystem<Network>();
     String address = serverAddress->GetText().Trimmed();
-    network->Connect((address.Empty()) ? "localhost" : address, SERVER_PORT, scene_);
+    VariantMap identity;
+    identity[PLAYER_TOKEN] = playerToken_;
+
+    connectTime_ = GetSubsystem<Time>()->GetElapsedTime();
+    network->Connect((address.Empty()) ? "localhost" : address, serverPort_, scene_, identity);
 
     window_->SetVisible(false);
     ready_->SetVisible(true);
@@ -406,15 +847,22 @@ void Main::HandleDisconnect(StringHash eventType, VariantMap& eventData) {
     if (serverConnection) {
         serverConnection->Disconnect();
         scene_->Clear(true, false);
+        snapshotClient_.Clear();
+        remotePlayers_.Reset();
+        predictor_.Detach();
         clientObjectID_ = 0;
     } else if (network->IsServerRunning()) {
         network->StopServer();
         scene_->Clear(true, false);
+        scene_->SetUpdateEnabled(true);
+        scene_->GetComponent<PhysicsWorld>()->SetMaxSubSteps(0);
+        arenas_.Clear();
+        connectionArenas_.Clear();
+        inputQueues_.Clear();
     }
 }
 void Main::HandleStartServer(StringHash eventType, VariantMap& eventData) {
-    Network* network = GetSubsystem<Network>();
-    network->StartServer(SERVER_PORT);
+    StartServer();
 
     window_->SetVisible(false);
 
@@ -436,39 +884,107 @@ void Main::HandleQuit(StringHash eventType, VariantMap& eventData) {
     engine_->Exit();
 }
 
-void Main::ServerPrePhysics(float timeStep) {
-    ProcessClientControls(timeStep);
-
-    Network* network = GetSubsystem<Network>();
-    const Vector<SharedPtr<Connection> >& connections = network->GetClientConnections();
-    Vector<Vector3> playerPositions;
-
-    for (unsigned i = 0; i < connections.Size(); ++i) {
-        Connection* connection = connections[i];
-        Player* playerObject = serverObjects_[connection];
-
-        if (!playerObject || playerObject->pNode == NULL) continue;
-
-        playerPositions.Push(serverObjects_[connection]->pRigidBody->GetPosition());
+Arena* Main::GetArena(Connection* connection) const {
+    HashMap<Connection*, Arena*>::ConstIterator i = connectionArenas_.Find(connection);
+    return i != connectionArenas_.End() ? i->second_ : nullptr;
+}
+void Main::ServerPrePhysics(Arena* arena, float timeStep) {
+    FrameProfiler* profiler = GetSubsystem<FrameProfiler>();
+    {
+        ProfileScope scope(profiler, "Client controls");
+        ProcessClientControls(arena, timeStep);
     }
 
-    boids.Update(timeStep, playerPositions);
+    // Forces were computed for every arena in parallel just before this step
+    {
+        ProfileScope scope(profiler, "Boid apply");
+        arena->boids.Integrate(timeStep);
+    }
+    ProfileScope scope(profiler, "Grid rebuild");
+    arena->boids.UpdateGrid();
 }
 void Main::ClientPrePhysics(float timeStep) {
     Network* network = GetSubsystem<Network>();
     Connection* serverConnection = network->GetServerConnection();
 
     if (serverConnection) {
-        // serverConnection->SetPosition(cameraNode_->GetPosition());
-        serverConnection->SetControls(ClientToServerControls());
+        // Used by the server for interest management, bots have no camera and report their player instead
+        if (cameraNode_) serverConnection->SetPosition(cameraNode_->GetPosition());
+        else if (predictor_.IsAttached()) serverConnection->SetPosition(predictor_.player.pNode->GetPosition());
+
+        // Bots generate their input on the spot, players' was gathered over the frames since the last step
+        Controls controls;
+        float sampleTime = -1.0f;
+        if (bot_) {
+            controls = botControls_.Next(timeStep);
+            sampleTime = GetSubsystem<InputLatency>()->Now();
+        } else if (inputSampler_) {
+            controls = inputSampler_->Take(sampleTime);
+        }
+
+        // The own player is predicted locally once its replicated node has arrived
+        if (!predictor_.IsAttached() && clientObjectID_ > 0) {
+            Node* playerNode = scene_->GetNode(clientObjectID_);
+            if (playerNode && playerNode->GetComponent<RigidBody>()) {
+                if (remotePlayers_) remotePlayers_->SetLocalPlayer(clientObjectID_);
+                predictor_.Attach(playerNode);
+            }
+        }
+        if (predictor_.IsAttached()) {
+            predictor_.Predict(controls, timeStep, sampleTime);
+            predictor_.WriteInputs(controls);
+        }
+
+        controls.extraData_[SNAPSHOT_ACK] = snapshotClient_.lastReceived;
+        controls.extraData_[SNAPSHOT_COUNT] = snapshotClient_.numReceived;
+        serverConnection->SetControls(controls);
     }
 }
 void Main::ServerUpdate(float timeStep) {
+    // The listen server's own view keeps the regions it looks at awake
+    if (!headless_ && cameraNode_) {
+        arenas_[0]->observers.Clear();
+        arenas_[0]->observers.Push(cameraNode_->GetPosition());
+    }
+
+    // Fixed steps, flocking on the worker threads before each, then each arena steps its physics and scene on this
+    // one. Forces are never applied to more than the step they were computed for, and frames between steps don't
+    // flock at all. The engine caps a frame at 0.1 s, so a hitch runs at most six steps.
+    FrameProfiler* profiler = GetSubsystem<FrameProfiler>();
+    TickScratch* scratch = GetSubsystem<TickScratch>();
+    float step = 1.0f / ArenaStepRate;
+
+    for (stepTime_ += timeStep; stepTime_ >= step; stepTime_ -= step) {
+        scratch->BeginTick();
+        {
+            ProfileScope scope(profiler, "Force computation");
+            FlockArenas(GetSubsystem<WorkQueue>(), arenas_, step);
+        }
+        for (unsigned i = 0; i < arenas_.Size(); i++) {
+            ProfileScope scope(profiler, "Scene update");
+            arenas_[i]->scene->Update(step);
+        }
+        scratch->EndTick(); // Scratch is given back after every step, and the step's heap allocations counted
+    }
+
+    if (checkpoint_) checkpoint_->Update(timeStep, arenas_[0]->boids, arenas_[0]->players);
+    Telemetry* telemetry = GetSubsystem<Telemetry>();
+    if (telemetry) telemetry->Update(timeStep, arenas_);
+
+    if (headless_) return;
+
     FrameInfo frameInfo = GetSubsystem<Renderer>()->GetFrameInfo();
     // fpsCounter->SetText("FPS: " + String((int)(1.0 / frameInfo.timeStep_)));
     fpsCounter->SetText("FPS: " + String((int)(1.0 / timeStep)));
 }
 void Main::ClientUpdate(float timeStep) {
+    // Remote entities are placed before the camera follows the player
+    float time = GetSubsystem<Time>()->GetElapsedTime();
+    snapshotClient_.Update(time);
+    if (remotePlayers_) remotePlayers_->Update(time);
+
+    if (headless_) return;
+
     if (clientObjectID_ > 0) {
         Node* playerNode = this->scene_->GetNode(clientObjectID_);
 
@@ -483,56 +999,38 @@ void Main::ClientUpdate(float timeStep) {
     fpsCounter->SetText("FPS: " + String((int)(1.0 / frameInfo.timeStep_)));
 }
 
-Controls Main::ClientToServerControls() {
-    Input* input = GetSubsystem<Input>();
-    Controls controls;
-
-    controls.Set(CTRL_FORWARD, input->GetKeyDown(KEY_W));
-    controls.Set(CTRL_BACK, input->GetKeyDown(KEY_S));
-    controls.Set(CTRL_LEFT, input->GetKeyDown(KEY_A));
-    controls.Set(CTRL_RIGHT, input->GetKeyDown(KEY_D));
-
-    controls.yaw_ = input->GetMouseMove().x_;
-    controls.pitch_ = input->GetMouseMove().y_;
-
-    return controls;
-}
-void Main::ProcessClientControls(float timeStep) {
-    Network* network = GetSubsystem<Network>();
-    const Vector<SharedPtr<Connection> >& connections = network->GetClientConnections();
+void Main::ProcessClientControls(Arena* arena, float timeStep) {
+    const Vector<SharedPtr<Connection> >& connections = arena->connections;
+    BoidSet& boids = arena->boids;
 
     for (unsigned i = 0; i < connections.Size(); ++i) {
         Connection* connection = connections[i];
-        Player* playerObject = serverObjects_[connection];
+        Player* playerObject = arena->GetPlayer(connection);
 
         if (!playerObject) continue;
 
-        playerObject->ApplyControls(connection->GetControls(), timeStep);
-
-        Ray cameraRay(playerObject->pNode->GetPosition(), playerObject->pNode->GetPosition() + playerObject->pNode->GetRotation() * Vector3::FORWARD * 100.0);
-        PhysicsRaycastResult result;
-        scene_->GetComponent<PhysicsWorld>()->SphereCast (result, cameraRay, 2.0, 5.0, 2);
-        if (result.body_) {
-            Component* component = result.body_->GetComponent("StaticModel");
-            Node* node = component->GetNode();
+        // One client input per physics step, in the order the client predicted them
+        InputQueue& inputs = inputQueues_[connection];
+        PlayerInput input;
+        inputs.Receive(connection->GetControls());
+        if (inputs.Pop(input)) {
+            input.ToControls(appliedControls_);
+            playerObject->ApplyControls(appliedControls_, timeStep);
+        }
 
-            if (node->GetName() == "BoidBig" || node->GetName() == "BoidSmall") {
-                if (node->GetName() == "BoidBig") playerObject->score += 5;
-                else if (node->GetName() == "BoidSmall") playerObject->score += 10;
+        BoidHit hit;
+        Node* playerNode = playerObject->pNode;
+        if (boids.SweepSphere(playerNode->GetPosition(), playerNode->GetRotation() * Vector3::FORWARD, 2.0f, 5.0f, hit)) {
+            Node* node = boids.boidList[hit.index].pNode;
 
-                ResourceCache* cache = GetSubsystem<ResourceCache>();
+            if (hit.isBig) playerObject->score += 5;
+            else playerObject->score += 10;
 
-                ParticleEffect* particleEffect = cache->GetResource<ParticleEffect>("Particle/SnowExplosionBig.xml");
-                Node* particleNode_ = scene_->CreateChild("ParticleEmitter");
-                ParticleEmitter* particleEmitter = particleNode_->CreateComponent<ParticleEmitter>();
-                particleEmitter->SetEffect(particleEffect);
-                particleNode_->SetPosition(node->GetPosition());
+            node->SetEnabled(false);
+            if (!headless_ && arena->scene == scene_) CreateBiteEffect(node->GetPosition());
 
-                node->SetEnabled(false);
-                VariantMap remoteEventData;
-                remoteEventData[PLAYER_SCORE] = playerObject->score;
-                connection->SendRemoteEvent (E_CLIENTSCORECHANGE, true, remoteEventData);
-            }
+            gameEvents_.Score(connection, playerObject->score);
+            gameEvents_.Kill(connections, hit.index, playerNode->GetID());
         }
     }
 }
@@ -2,6 +2,19 @@
 
 #include "Sample.h"
 #include "Player.h"
+#include "Preloader.h"
+#include "Checkpoint.h"
+#include "BoidSnapshot.h"
+#include "Interpolation.h"
+#include "Prediction.h"
+#include "GameEvents.h"
+#include "LoadTest.h"
+#include "Arena.h"
+#include "InputSampler.h"
+#include "FrameProfiler.h"
+#include "Telemetry.h"
+#include "FlockTest.h"
+#include "MemoryReport.h"
 
 namespace Urho3D {
     class Node;
@@ -17,28 +30,89 @@ public:
     ~Main();
 
     static const unsigned short SERVER_PORT = 2345;
+    unsigned short serverPort_;
     LineEdit* serverAddress;
+    Button* connectButton_;
+    Button* startButton_;
+    Text* loadingText_;
     SharedPtr<Window> window_, fps_, ready_, hud_;
 
     SharedPtr<Node> waterNode_, reflectionCameraNode_;
     Plane waterPlane_, waterClipPlane_;
 
     unsigned clientObjectID_ = 0;
-    HashMap<Connection*, Player*> serverObjects_;
 
+    virtual void Setup();
     virtual void Start();
 
 private:
     bool menuVisible_ = true;
+    bool useCompressedTextures_ = true;
+    bool textureReport_ = false;
+    bool usePackages_ = false;
+    bool headless_ = false;
+    bool bot_ = false;
+    bool spectate_ = false; // Bots that only watch, without spawning a player
+    bool relay_ = false;
+    String relayAddress_; // Game server a relay connects to
+    unsigned short relayPort_ = SERVER_PORT;
+    unsigned loadTestBots_ = 0;
+    int numBoids_;
+    unsigned numArenas_ = 1;
+    unsigned arenaCapacity_ = 16; // Players per arena before the assignment spills over to the next
+    int networkUpdateFps_ = 20;
+    float playoutDelay_ = 0.1f;
+    float wakeRadius_ = 0.0f; // Boids further than this from every player are dormant, 0 keeps the whole arena active
+    String checkpointPath_;
+    String profileCsvPath_;
+    String telemetryPath_; // File, or "unix:" and a socket path
+    float telemetryInterval_ = 5.0f;
+    String flockTestPath_; // Baseline timings of the flocking regression test
+    bool saveFlockBaseline_ = false;
+    SharedPtr<Checkpoint> checkpoint_;
+    Vector<SharedPtr<Arena> > arenas_;
+    HashMap<Connection*, Arena*> connectionArenas_;
+    SnapshotClient snapshotClient_;
+    SnapshotServer relaySnapshots_; // Re-encodes the flock received from upstream for the relay's spectators
+    SharedPtr<RemotePlayers> remotePlayers_;
+    PlayerPredictor predictor_;
+    SharedPtr<InputSampler> inputSampler_;
+    HashMap<Connection*, InputQueue> inputQueues_;
+    Controls appliedControls_; // Reused every step, constructing Controls allocates
+    VectorBuffer playerState_;
+    GameEventServer gameEvents_;
+    PODVector<GameEvent> receivedEvents_;
+    SharedPtr<LoadTest> loadTest_;
+    BotControls botControls_;
+    String playerToken_; // Sent when connecting, for the server to give back a checkpointed score
+    float connectTime_ = 0.0f; // When the client started connecting, for timing the join
+    float snapshotLogTimer_ = 0.0f;
+    float stepTime_ = 0.0f; // Server time not yet stepped, under one ArenaStepRate step
+    unsigned long long snapshotLogBytes_ = 0;
+    SharedPtr<Preloader> preloader_;
 
     void SubscribeToEvents();
 
+    // Resources
+    void AddCompressedTextures();
+    void ReportTextureLoadTimes();
+    void MapResourcePackages();
+    void CreateStats();
+    void StartPreload();
+    void UpdatePreload();
+
     // Object Creators
+    bool StartServer();
+    void StartDedicatedServer();
+    void StartBot();
+    void StartRelay();
+    void RunFlockTest();
     void CreateMainMenu();
     void CreateGameScene();
     void CreateClientObjects();
     void CreateServerObjects();
-    Player* CreateCharacter();
+    Player* CreateCharacter(Scene* pScene);
+    void CreateBiteEffect(const Vector3& position);
 
     // Urho Event Handlers
     void HandleUpdate(StringHash eventType, VariantMap& eventData);
@@ -47,11 +121,12 @@ private:
     void HandleClientConnected(StringHash eventType, VariantMap& eventData);
     void HandleClientDisconnected(StringHash eventType, VariantMap& eventData);
     void HandleServerDisconnected(StringHash eventType, VariantMap& eventData);
+    void HandleNetworkMessage(StringHash eventType, VariantMap& eventData);
+    void HandleNetworkUpdate(StringHash eventType, VariantMap& eventData);
 
     // Custom Network Events
-    void HandleServerToClientObjectID(StringHash eventType, VariantMap& eventData);
     void HandleClientToServerReadyToStart(StringHash eventType, VariantMap& eventData);
-    void HandleServerToClientScoreIncreased(StringHash eventType, VariantMap& eventData);
+    void HandleGameEvents(MemoryBuffer& message);
 
     // Menu Events
     void HandleConnect(StringHash eventType, VariantMap& eventData);
@@ -61,11 +136,11 @@ private:
     void HandleQuit(StringHash eventType, VariantMap& eventData);
 
     // Game logic
-    void ServerPrePhysics(float timeStep);
+    Arena* GetArena(Connection* connection) const;
+    void ServerPrePhysics(Arena* arena, float timeStep);
     void ClientPrePhysics(float timeStep);
     void ServerUpdate(float timeStep);
     void ClientUpdate(float timeStep);
 
-    Controls ClientToServerControls();
-    void ProcessClientControls(float timeStep);
+    void ProcessClientControls(Arena* arena, float timeStep);
 };
@@ -0,0 +1,56 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::Open(const String& fileName) {
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(WString(fileName).CString(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    fileHandle_ = file;
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) return false;
+    mappingHandle_ = mapping;
+
+    size = GetFileSize(file, nullptr);
+    data = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    fileDescriptor_ = open(fileName.CString(), O_RDONLY);
+    if (fileDescriptor_ < 0) return false;
+
+    struct stat info;
+    if (fstat(fileDescriptor_, &info) != 0 || info.st_size == 0) return false;
+
+    size = (unsigned)info.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor_, 0);
+    data = mapping == MAP_FAILED ? nullptr : (unsigned char*)mapping;
+#endif
+
+    return data != nullptr;
+}
+
+void MappedFile::Close() {
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle_) CloseHandle((HANDLE)mappingHandle_);
+    if (fileHandle_) CloseHandle((HANDLE)fileHandle_);
+    mappingHandle_ = nullptr;
+    fileHandle_ = nullptr;
+#else
+    if (data) munmap(data, size);
+    if (fileDescriptor_ >= 0) close(fileDescriptor_);
+    fileDescriptor_ = -1;
+#endif
+
+    data = nullptr;
+    size = 0;
+}
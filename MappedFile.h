@@ -0,0 +1,28 @@
+#pragma once
+#include <Urho3D/Container/Str.h>
+
+using namespace Urho3D;
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    unsigned char* data = nullptr;
+    unsigned size = 0;
+
+    // Methods
+    MappedFile() {};
+    ~MappedFile() { Close(); }
+    bool Open(const String& fileName);
+    void Close();
+
+private:
+#ifdef _WIN32
+    void* fileHandle_ = nullptr;
+    void* mappingHandle_ = nullptr;
+#else
+    int fileDescriptor_ = -1;
+#endif
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
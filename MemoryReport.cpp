@@ -0,0 +1,182 @@
+#include <Urho3D/Engine/EngineEvents.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/ParticleEmitter.h>
+#include <Urho3D/Graphics/Skybox.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/Graphics/Zone.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Network/NetworkPriority.h>
+#include <Urho3D/Physics/CollisionShape.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Bullet/BulletCollision/CollisionShapes/btBoxShape.h>
+#include <Bullet/BulletCollision/CollisionShapes/btCompoundShape.h>
+#include <Bullet/BulletDynamics/Dynamics/btRigidBody.h>
+
+#include "MemoryReport.h"
+#include "Telemetry.h"
+
+const char* MemoryCategoryNames[NUM_MEMORY_CATEGORIES] = { "Scene nodes", "Components", "Physics", "Resources",
+    "Network buffers", "Particle emitters", "Simulation" };
+const char* MemoryCategoryKeys[NUM_MEMORY_CATEGORIES] = { "nodes", "components", "physics", "resources", "network",
+    "particles", "simulation" };
+
+MemoryReport::MemoryReport(Context* context) : Object(context) {
+    RegisterSize<Camera>();
+    RegisterSize<CollisionShape>();
+    RegisterSize<Light>();
+    RegisterSize<NetworkPriority>();
+    RegisterSize<Octree>();
+    RegisterSize<ParticleEmitter>();
+    RegisterSize<PhysicsWorld>();
+    RegisterSize<RigidBody>();
+    RegisterSize<Skybox>();
+    RegisterSize<StaticModel>();
+    RegisterSize<Zone>();
+
+    SubscribeToEvent(E_CONSOLECOMMAND, URHO3D_HANDLER(MemoryReport, HandleConsoleCommand));
+}
+
+void MemoryReport::AddScene(Scene* scene) {
+    WeakPtr<Scene> weak(scene);
+    if (scene && !scenes_.Contains(weak)) scenes_.Push(weak);
+}
+
+unsigned long long MemoryReport::MeasureNode(Node* node) {
+    unsigned long long bytes = sizeof(Node);
+    categories[MEM_NODES].Add(sizeof(Node));
+
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    for (unsigned i = 0; i < components.Size(); i++) {
+        Component* component = components[i];
+        HashMap<StringHash, unsigned>::ConstIterator size = componentSizes_.Find(component->GetType());
+        unsigned long long componentBytes = size != componentSizes_.End() ? size->second_ : UnknownComponentSize;
+        MemoryCategory category = MEM_COMPONENTS;
+
+        // Bullet's side of the physics components, the rigid body keeps two compound shapes of its own
+        if (RigidBody* body = component->Cast<RigidBody>()) {
+            if (body->GetBody()) {
+                unsigned long long physicsBytes = sizeof(btRigidBody) + 2 * sizeof(btCompoundShape);
+                categories[MEM_PHYSICS].Add(physicsBytes);
+                bytes += physicsBytes;
+            }
+        } else if (CollisionShape* shape = component->Cast<CollisionShape>()) {
+            if (shape->GetCollisionShape()) {
+                unsigned long long physicsBytes = shape->GetShapeType() == SHAPE_BOX ? sizeof(btBoxShape) : sizeof(btCollisionShape);
+                categories[MEM_PHYSICS].Add(physicsBytes);
+                bytes += physicsBytes;
+            }
+        } else if (ParticleEmitter* emitter = component->Cast<ParticleEmitter>()) {
+            componentBytes += emitter->GetNumParticles() * (sizeof(Particle) + sizeof(Billboard));
+            category = MEM_PARTICLES;
+        }
+
+        if (Drawable* drawable = component->Cast<Drawable>()) componentBytes += drawable->GetBatches().Capacity() * sizeof(SourceBatch);
+
+        categories[category].Add(componentBytes);
+        bytes += componentBytes;
+    }
+
+    const Vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (unsigned i = 0; i < children.Size(); i++) bytes += MeasureNode(children[i]);
+    return bytes;
+}
+
+void MemoryReport::Measure() {
+    for (unsigned i = 0; i < NUM_MEMORY_CATEGORIES; i++) categories[i] = MemoryUsage();
+    entities.Clear();
+    resources.Clear();
+
+    for (unsigned i = 0; i < scenes_.Size(); i++) {
+        Scene* scene = scenes_[i];
+        if (!scene) continue;
+
+        const Vector<SharedPtr<Node> >& nodes = scene->GetChildren();
+        for (unsigned j = 0; j < nodes.Size(); j++) {
+            const String& name = nodes[j]->GetName();
+            entities[name.Empty() ? String("Unnamed") : name].Add(MeasureNode(nodes[j]));
+        }
+    }
+
+    const HashMap<StringHash, ResourceGroup>& groups = GetSubsystem<ResourceCache>()->GetAllResources();
+    for (HashMap<StringHash, ResourceGroup>::ConstIterator i = groups.Begin(); i != groups.End(); ++i) {
+        const ResourceGroup& group = i->second_;
+        if (group.resources_.Empty()) continue;
+
+        resources[group.resources_.Front().second_->GetTypeName()].Add(group.memoryUse_, group.resources_.Size());
+        categories[MEM_RESOURCES].Add(group.memoryUse_, group.resources_.Size());
+    }
+
+    if (arenas) {
+        for (unsigned i = 0; i < arenas->Size(); i++) {
+            const Arena* arena = arenas->At(i);
+            categories[MEM_NETWORK].Add(arena->snapshots.GetMemoryUse());
+            categories[MEM_SIMULATION].Add(arena->boids.GetMemoryUse());
+        }
+    }
+    if (snapshotClient) categories[MEM_NETWORK].Add(snapshotClient->GetMemoryUse());
+    if (relaySnapshots) categories[MEM_NETWORK].Add(relaySnapshots->GetMemoryUse());
+    if (gameEvents) categories[MEM_NETWORK].Add(gameEvents->GetMemoryUse());
+
+    TickScratch* scratch = GetSubsystem<TickScratch>();
+    if (scratch) categories[MEM_SIMULATION].Add(scratch->GetMemoryUse());
+
+    processBytes = GetProcessMemory();
+}
+
+unsigned long long MemoryReport::GetTotal() const {
+    unsigned long long total = 0;
+    for (unsigned i = 0; i < NUM_MEMORY_CATEGORIES; i++) total += categories[i].bytes;
+    return total;
+}
+
+String MemoryReport::GetReport() const {
+    String report;
+    report.AppendWithFormat("Memory: %.1f MB accounted for, %.1f MB resident", GetTotal() / 1048576.0, processBytes / 1048576.0);
+    for (unsigned i = 0; i < NUM_MEMORY_CATEGORIES; i++) {
+        report.AppendWithFormat("\n  %-20s %8.1f KB in %u", MemoryCategoryNames[i], categories[i].bytes / 1024.0, categories[i].count);
+    }
+
+    report += "\nBy entity:";
+    for (HashMap<String, MemoryUsage>::ConstIterator i = entities.Begin(); i != entities.End(); ++i) {
+        report.AppendWithFormat("\n  %-20s %8.1f KB for %u, %.0f bytes each", i->first_.CString(), i->second_.bytes / 1024.0,
+            i->second_.count, (double)i->second_.bytes / i->second_.count);
+    }
+
+    report += "\nResources by type:";
+    for (HashMap<String, MemoryUsage>::ConstIterator i = resources.Begin(); i != resources.End(); ++i) {
+        report.AppendWithFormat("\n  %-20s %8.1f KB in %u", i->first_.CString(), i->second_.bytes / 1024.0, i->second_.count);
+    }
+    return report;
+}
+
+String MemoryReport::GetJson() const {
+    String json;
+    json.AppendWithFormat("{\"accounted\":%llu,\"resident\":%llu", GetTotal(), processBytes);
+    for (unsigned i = 0; i < NUM_MEMORY_CATEGORIES; i++) {
+        json.AppendWithFormat(",\"%s\":{\"count\":%u,\"bytes\":%llu}", MemoryCategoryKeys[i], categories[i].count, categories[i].bytes);
+    }
+
+    json += ",\"entities\":{";
+    for (HashMap<String, MemoryUsage>::ConstIterator i = entities.Begin(); i != entities.End(); ++i) {
+        if (i != entities.Begin()) json += ',';
+        json.AppendWithFormat("\"%s\":{\"count\":%u,\"bytes\":%llu}", i->first_.CString(), i->second_.count, i->second_.bytes);
+    }
+    json += "}}";
+    return json;
+}
+
+void MemoryReport::HandleConsoleCommand(StringHash eventType, VariantMap& eventData) {
+    using namespace ConsoleCommand;
+
+    if (eventData[P_ID].GetString() != GetTypeName()) return;
+
+    if (eventData[P_COMMAND].GetString().Trimmed() == "memory") {
+        Measure();
+        URHO3D_LOGINFO(GetReport());
+    }
+}
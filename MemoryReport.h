@@ -0,0 +1,72 @@
+#pragma once
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Container/Ptr.h>
+
+#include "Arena.h"
+#include "GameEvents.h"
+
+namespace Urho3D {
+    class Node;
+    class Scene;
+}
+
+using namespace Urho3D;
+
+const static unsigned UnknownComponentSize = 256; // Assumed for component types without a registered size
+
+enum MemoryCategory {
+    MEM_NODES = 0,
+    MEM_COMPONENTS,
+    MEM_PHYSICS, // Bullet objects behind the rigid bodies and collision shapes
+    MEM_RESOURCES,
+    MEM_NETWORK, // Our snapshot and event buffers; the engine's own connection buffers are not visible from here
+    MEM_PARTICLES,
+    MEM_SIMULATION, // Boid lists and grids, tick scratch
+    NUM_MEMORY_CATEGORIES
+};
+
+extern const char* MemoryCategoryNames[NUM_MEMORY_CATEGORIES];
+extern const char* MemoryCategoryKeys[NUM_MEMORY_CATEGORIES]; // In the telemetry JSON
+
+struct MemoryUsage {
+    unsigned count = 0;
+    unsigned long long bytes = 0;
+
+    void Add(unsigned long long size, unsigned number = 1) { bytes += size; count += number; }
+};
+
+// Subsystem estimating where the server's memory goes, by category and by entity type. Entities are the scenes'
+// top level nodes grouped by name, each with its children, components and Bullet objects, so the cost per boid can
+// be read off directly and leaks such as forgotten emitters show up as a growing count. Sizes are sizeof the objects
+// and the capacity of their buffers, not allocator overhead; the process resident size is reported alongside.
+// Measured on demand, by the "memory" console command and each telemetry record.
+class MemoryReport : public Object {
+    URHO3D_OBJECT(MemoryReport, Object);
+
+public:
+    const Vector<SharedPtr<Arena> >* arenas = nullptr;
+    const SnapshotClient* snapshotClient = nullptr;
+    const SnapshotServer* relaySnapshots = nullptr;
+    const GameEventServer* gameEvents = nullptr;
+    MemoryUsage categories[NUM_MEMORY_CATEGORIES];
+    HashMap<String, MemoryUsage> entities; // By node name
+    HashMap<String, MemoryUsage> resources; // By resource type
+    unsigned long long processBytes = 0;
+
+    // Methods
+    MemoryReport(Context* context);
+    void AddScene(Scene* scene);
+    void Measure();
+    unsigned long long GetTotal() const;
+    String GetReport() const;
+    String GetJson() const;
+
+private:
+    Vector<WeakPtr<Scene> > scenes_;
+    HashMap<StringHash, unsigned> componentSizes_;
+
+    template <class T> void RegisterSize() { componentSizes_[T::GetTypeStatic()] = sizeof(T); }
+    unsigned long long MeasureNode(Node* node);
+    void HandleConsoleCommand(StringHash eventType, VariantMap& eventData);
+};
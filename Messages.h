@@ -0,0 +1,19 @@
+#pragma once
+#include <Urho3D/Math/StringHash.h>
+
+using namespace Urho3D;
+
+// Custom network message IDs, kept clear of the engine's own protocol messages
+const static int MSG_BOIDSNAPSHOT = 0x100; // Server -> client, unreliable
+const static int MSG_PLAYERSTATE = 0x101; // Server -> client, unreliable: authoritative state of the client's own player
+const static int MSG_GAMEEVENTS = 0x102; // Server -> client, reliable: spawns, scores and kills of one network update
+const static int MSG_JOINSNAPSHOT = 0x103; // Server -> client, reliable: header and compressed chunks of the flock on joining
+
+// Keys in Controls::extraData_ sent from client to server every network update
+static const StringHash SNAPSHOT_ACK("SnapshotAck"); // Last boid snapshot the client decoded
+static const StringHash PLAYER_INPUTS("PlayerInputs"); // Buffer of sequence-numbered inputs the server has not acked
+static const StringHash SNAPSHOT_COUNT("SnapshotCount"); // Boid snapshots received since connecting, for loss estimation
+
+// Keys in the connection identity
+static const StringHash SPECTATOR_RELAY("SpectatorRelay"); // The connection re-broadcasts to spectators rather than playing
+static const StringHash PLAYER_TOKEN("PlayerToken"); // Random per client process, keys the player's checkpointed score
@@ -0,0 +1,141 @@
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Engine/DebugHud.h>
+#include <Urho3D/Engine/EngineEvents.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Network/Network.h>
+
+#include "NetStats.h"
+
+const char* NetChannelNames[NUM_NET_CHANNELS] = { "snapshots", "player state", "spawns", "scores", "kills", "join" };
+
+NetStats::NetStats(Context* context) : Object(context) {
+    SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(NetStats, HandleUpdate));
+    SubscribeToEvent(E_CONSOLECOMMAND, URHO3D_HANDLER(NetStats, HandleConsoleCommand));
+}
+
+ConnectionStats& NetStats::Get(Connection* connection) {
+    // The label is taken now, a connection may be gone by the time its entry is reported or forgotten
+    HashMap<Connection*, ConnectionStats>::Iterator i = stats_.Find(connection);
+    if (i != stats_.End()) return i->second_;
+
+    ConnectionStats& stats = stats_[connection];
+    stats.label = "Net " + connection->ToString();
+    return stats;
+}
+
+void NetStats::SetSnapshotRate(Connection* connection, float rate, float budget, float usage) {
+    ConnectionStats& stats = Get(connection);
+    stats.snapshotRate = rate;
+    stats.snapshotBudget = budget;
+    stats.snapshotUsage = usage;
+}
+
+const ConnectionStats* NetStats::GetStats(Connection* connection) const {
+    HashMap<Connection*, ConnectionStats>::ConstIterator i = stats_.Find(connection);
+    return i != stats_.End() ? &i->second_ : nullptr;
+}
+
+String NetStats::GetReport(Connection* connection) const {
+    const ConnectionStats* stats = GetStats(connection);
+    if (!stats) return String::EMPTY;
+
+    String report;
+    report.AppendWithFormat("in %.0f B/s %.0f pkt/s, out %.0f B/s %.0f pkt/s, rtt %.0f ms;", stats->bytesInPerSec,
+        stats->packetsInPerSec, stats->bytesOutPerSec, stats->packetsOutPerSec, stats->roundTrip);
+    for (unsigned i = 0; i < NUM_NET_CHANNELS; i++) {
+        if (stats->channelBytes[i]) report.AppendWithFormat(" %s %.0f B/s,", NetChannelNames[i], stats->channelPerSec[i]);
+    }
+    report.AppendWithFormat(" replication and other %.0f B/s", stats->otherPerSec);
+    if (stats->snapshotBudget > 0.0f) {
+        report.AppendWithFormat("; snapshots at %.0f/s, %.0f%% of %.0f B/s budget", stats->snapshotRate,
+            stats->snapshotUsage * 100.0f / stats->snapshotBudget, stats->snapshotBudget);
+    }
+    return report;
+}
+
+void NetStats::LogReport() const {
+    for (HashMap<Connection*, ConnectionStats>::ConstIterator i = stats_.Begin(); i != stats_.End(); ++i) {
+        URHO3D_LOGINFOF("%s: %s", i->second_.label.CString(), GetReport(i->first_).CString());
+    }
+}
+
+void NetStats::RemoveConnection(Connection* connection) {
+    HashMap<Connection*, ConnectionStats>::Iterator i = stats_.Find(connection);
+    if (i == stats_.End()) return;
+
+    DebugHud* debugHud = GetSubsystem<DebugHud>();
+    if (debugHud) debugHud->ResetAppStats(i->second_.label);
+    stats_.Erase(i);
+}
+
+void NetStats::Sample(float interval) {
+    Network* network = GetSubsystem<Network>();
+    DebugHud* debugHud = GetSubsystem<DebugHud>();
+
+    connections_.Clear();
+    const Vector<SharedPtr<Connection> >& clients = network->GetClientConnections();
+    for (unsigned i = 0; i < clients.Size(); i++) connections_.Push(clients[i]);
+    if (network->GetServerConnection()) connections_.Push(network->GetServerConnection());
+
+    // Forget connections that went without RemoveConnection. They may already be freed and the pointers reused, so
+    // only the stored label is used.
+    for (HashMap<Connection*, ConnectionStats>::Iterator i = stats_.Begin(); i != stats_.End();) {
+        if (connections_.Contains(i->first_)) {
+            ++i;
+            continue;
+        }
+        if (debugHud) debugHud->ResetAppStats(i->second_.label);
+        i = stats_.Erase(i);
+    }
+
+    for (unsigned i = 0; i < connections_.Size(); i++) {
+        Connection* connection = connections_[i];
+        ConnectionStats& stats = Get(connection);
+
+        stats.bytesInPerSec = connection->GetBytesInPerSec();
+        stats.bytesOutPerSec = connection->GetBytesOutPerSec();
+        stats.packetsInPerSec = connection->GetPacketsInPerSec();
+        stats.packetsOutPerSec = connection->GetPacketsOutPerSec();
+        stats.roundTrip = connection->GetRoundTripTime();
+
+        float counted = 0.0f;
+        for (unsigned j = 0; j < NUM_NET_CHANNELS; j++) {
+            stats.channelPerSec[j] = (stats.channelBytes[j] - stats.sampledBytes[j]) / interval;
+            stats.sampledBytes[j] = stats.channelBytes[j];
+            counted += stats.channelPerSec[j];
+        }
+        stats.otherPerSec = Max(stats.bytesOutPerSec - counted, 0.0f);
+
+        if (debugHud) debugHud->SetAppStats(stats.label, GetReport(connection));
+    }
+}
+
+void NetStats::HandleUpdate(StringHash eventType, VariantMap& eventData) {
+    using namespace Update;
+
+    float timeStep = eventData[P_TIMESTEP].GetFloat();
+
+    sampleTimer_ += timeStep;
+    if (sampleTimer_ >= 1.0f) {
+        Sample(sampleTimer_);
+        sampleTimer_ = 0.0f;
+    }
+
+    logTimer_ += timeStep;
+    if (logTimer_ >= logInterval) {
+        LogReport();
+        logTimer_ = 0.0f;
+    }
+}
+
+void NetStats::HandleConsoleCommand(StringHash eventType, VariantMap& eventData) {
+    using namespace ConsoleCommand;
+
+    if (eventData[P_ID].GetString() != GetTypeName()) return;
+
+    if (eventData[P_COMMAND].GetString().Trimmed() == "netstats") {
+        if (stats_.Empty()) URHO3D_LOGINFO("No connections");
+        else LogReport();
+    }
+}
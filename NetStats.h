@@ -0,0 +1,68 @@
+#pragma once
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Container/HashMap.h>
+
+namespace Urho3D {
+    class Connection;
+}
+
+using namespace Urho3D;
+
+// Our own traffic, counted as it is written. Whatever else the engine sends (scene replication of the player nodes,
+// remote events, acks) is reported as the remainder of the measured total.
+enum NetChannel {
+    NET_SNAPSHOTS = 0,
+    NET_PLAYERSTATE,
+    NET_SPAWNS,
+    NET_SCORES,
+    NET_KILLS,
+    NET_JOIN,
+    NUM_NET_CHANNELS
+};
+
+extern const char* NetChannelNames[NUM_NET_CHANNELS];
+
+struct ConnectionStats {
+    String label; // "Net" and the address, taken while the connection was alive for the HUD and log
+    float bytesInPerSec = 0.0f;
+    float bytesOutPerSec = 0.0f;
+    float packetsInPerSec = 0.0f;
+    float packetsOutPerSec = 0.0f;
+    float roundTrip = 0.0f; // Milliseconds
+    float channelPerSec[NUM_NET_CHANNELS] = {};
+    float otherPerSec = 0.0f; // Bytes out not accounted for by the channels
+    float snapshotRate = 0.0f; // Per second, chosen by the connection's rate control; 0 when not adapted
+    float snapshotBudget = 0.0f; // Bytes per second
+    float snapshotUsage = 0.0f;
+    unsigned long long channelBytes[NUM_NET_CHANNELS] = {}; // Since connected
+    unsigned long long sampledBytes[NUM_NET_CHANNELS] = {}; // channelBytes at the last sample
+};
+
+// Subsystem collecting per-connection traffic once a second. Shown in the debug HUD, logged every logInterval seconds
+// while connected, and printed by the "netstats" console command.
+class NetStats : public Object {
+    URHO3D_OBJECT(NetStats, Object);
+
+public:
+    float logInterval = 5.0f;
+
+    // Methods
+    NetStats(Context* context);
+    void Count(Connection* connection, NetChannel channel, unsigned bytes) { Get(connection).channelBytes[channel] += bytes; }
+    void SetSnapshotRate(Connection* connection, float rate, float budget, float usage);
+    const ConnectionStats* GetStats(Connection* connection) const;
+    String GetReport(Connection* connection) const;
+    void LogReport() const;
+    void RemoveConnection(Connection* connection); // While it is still alive, before Network frees it
+
+private:
+    HashMap<Connection*, ConnectionStats> stats_;
+    PODVector<Connection*> connections_;
+    float sampleTimer_ = 0.0f;
+    float logTimer_ = 0.0f;
+
+    ConnectionStats& Get(Connection* connection);
+    void Sample(float interval);
+    void HandleUpdate(StringHash eventType, VariantMap& eventData);
+    void HandleConsoleCommand(StringHash eventType, VariantMap& eventData);
+};
@@ -0,0 +1,93 @@
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/IO/Compression.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/Resource/Resource.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <LZ4/lz4.h>
+
+#include "PackageLoader.h"
+
+MappedPackage::MappedPackage(Context* context) {
+    package = new PackageFile(context);
+}
+
+bool MappedPackage::Open(const String& fileName) {
+    // PackageFile only reads the directory, the contents are accessed through the mapping
+    return package->Open(fileName) && file.Open(fileName);
+}
+
+const unsigned char* MappedPackage::GetData(const String& name, unsigned& dataSize, PODVector<unsigned char>& scratch) const {
+    // Entries come from the package's own directory, a truncated or corrupt file must not send us past the mapping
+    const PackageEntry* entry = package->GetEntry(name);
+    if (!entry || entry->offset_ >= file.size) return nullptr;
+
+    const unsigned char* src = file.data + entry->offset_;
+    unsigned remaining = file.size - entry->offset_;
+    dataSize = entry->size_;
+
+    if (!package->IsCompressed() || dataSize == 0) return dataSize <= remaining ? src : nullptr;
+
+    // Compressed entries are a sequence of blocks, each with an unpacked and packed size header. The entry size is
+    // the unpacked one, so each block is checked against what is left of the file instead.
+    scratch.Resize(dataSize);
+    unsigned produced = 0;
+
+    while (produced < dataSize) {
+        if (remaining < 4) return nullptr;
+
+        unsigned unpackedSize = src[0] | (src[1] << 8);
+        unsigned packedSize = src[2] | (src[3] << 8);
+        if (packedSize > remaining - 4 || unpackedSize > dataSize - produced) return nullptr;
+
+        // The bounded decoder, a corrupt block must not read or write past its sizes either
+        if (LZ4_decompress_safe((const char*)src + 4, (char*)&scratch[produced], packedSize, unpackedSize) != (int)unpackedSize) {
+            return nullptr;
+        }
+        produced += unpackedSize;
+        src += 4 + packedSize;
+        remaining -= 4 + packedSize;
+    }
+
+    return &scratch[0];
+}
+
+PackageLoader::PackageLoader(Context* context) : Object(context) {}
+
+bool PackageLoader::AddPackage(const String& fileName) {
+    SharedPtr<MappedPackage> mapped(new MappedPackage(context_));
+
+    if (!mapped->Open(fileName)) {
+        URHO3D_LOGERRORF("Failed to map resource package %s", fileName.CString());
+        return false;
+    }
+
+    packages_.Push(mapped);
+    return true;
+}
+
+bool PackageLoader::LoadResource(StringHash type, const String& name) {
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    if (cache->GetExistingResource(type, name)) return true;
+
+    for (unsigned i = 0; i < packages_.Size(); i++) {
+        unsigned dataSize = 0;
+        const unsigned char* data = packages_[i]->GetData(name, dataSize, scratch_);
+        if (!data) continue;
+
+        SharedPtr<Resource> resource = DynamicCast<Resource>(context_->CreateObject(type));
+        if (!resource) return false;
+
+        MemoryBuffer buffer(data, dataSize);
+        buffer.SetName(name);
+        resource->SetName(name);
+        if (!resource->Load(buffer)) return false;
+
+        if (packages_[i]->package->IsCompressed()) numDecompressed++;
+        else numMapped++;
+
+        return cache->AddManualResource(resource);
+    }
+
+    return false;
+}
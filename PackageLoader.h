@@ -0,0 +1,40 @@
+#pragma once
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Container/Vector.h>
+#include <Urho3D/IO/PackageFile.h>
+
+#include "MappedFile.h"
+
+using namespace Urho3D;
+
+// A resource package mapped into memory. Uncompressed packages are read in place,
+// LZ4 compressed ones are decompressed block by block when an entry is requested.
+class MappedPackage : public RefCounted {
+public:
+    SharedPtr<PackageFile> package;
+    MappedFile file;
+
+    // Methods
+    MappedPackage(Context* context);
+    bool Open(const String& fileName);
+    const unsigned char* GetData(const String& name, unsigned& dataSize, PODVector<unsigned char>& scratch) const;
+};
+
+// Subsystem serving resources straight from memory-mapped packages, bypassing per-file open/read
+class PackageLoader : public Object {
+    URHO3D_OBJECT(PackageLoader, Object);
+
+public:
+    unsigned numMapped = 0; // Resources read in place
+    unsigned numDecompressed = 0; // Resources decompressed from an LZ4 package
+
+    // Methods
+    PackageLoader(Context* context);
+    bool AddPackage(const String& fileName);
+    bool LoadResource(StringHash type, const String& name);
+    unsigned GetNumPackages() const { return packages_.Size(); }
+
+private:
+    Vector<SharedPtr<MappedPackage> > packages_;
+    PODVector<unsigned char> scratch_;
+};
@@ -1,3 +1,5 @@
+#include <Urho3D/Network/NetworkPriority.h>
+
 #include "Player.h"
 
 Player::Player() {
@@ -26,9 +28,20 @@ void Player::Initialise(ResourceCache *pRes, Scene *pScene) {
     pCollisionShape = pNode->CreateComponent<CollisionShape>();
     pCollisionShape->SetBox(pNode->GetScale());
 
+    NetworkPriority* priority = pNode->CreateComponent<NetworkPriority>();
+    priority->SetBasePriority(100.0f);
+    priority->SetMinPriority(0.0f);
+    SetDistancePriority(true);
+
     pNode->SetEnabled(true);
 }
 
+void Player::SetDistancePriority(bool enabled) {
+    // Replication rate falls off with distance from each client's camera and stops at the fog end (300)
+    NetworkPriority* priority = pNode->GetComponent<NetworkPriority>();
+    if (priority) priority->SetDistanceFactor(enabled ? 100.0f / 300.0f : 0.0f);
+}
+
 void Player::ApplyControls(const Controls& controls, float timeStep) {
     if (pNode) {
         const float MOVE_SPEED = 25.0f;
@@ -50,5 +50,6 @@ public:
     Player();
     void Initialise(ResourceCache *pRes, Scene *pScene);
     void ApplyControls(const Controls& controls, float timeStep);
+    void SetDistancePriority(bool enabled); // Off, every client is sent the player at the full update rate
     void ResetScore() { score = 0; }
 };
@@ -0,0 +1,168 @@
+#include <Urho3D/Physics/RigidBody.h>
+#include <Urho3D/Scene/Node.h>
+
+#include "InputSampler.h"
+#include "Messages.h"
+#include "Prediction.h"
+
+Controls PlayerInput::ToControls() const {
+    Controls controls;
+    ToControls(controls);
+    return controls;
+}
+
+void PlayerInput::ToControls(Controls& controls) const {
+    controls.buttons_ = buttons;
+    controls.yaw_ = yaw;
+    controls.pitch_ = pitch;
+}
+
+void WritePlayerInputs(VectorBuffer& dest, const PODVector<PlayerInput>& inputs) {
+    dest.Clear();
+    dest.WriteVLE(inputs.Size());
+    for (unsigned i = 0; i < inputs.Size(); i++) {
+        dest.WriteUInt(inputs[i].sequence);
+        dest.WriteUByte((unsigned char)inputs[i].buttons);
+        dest.WriteFloat(inputs[i].yaw);
+        dest.WriteFloat(inputs[i].pitch);
+        dest.WriteFloat(inputs[i].timeStep);
+    }
+}
+
+void ReadPlayerInputs(MemoryBuffer& source, PODVector<PlayerInput>& inputs) {
+    unsigned count = source.ReadVLE();
+    inputs.Clear();
+
+    for (unsigned i = 0; i < count && !source.IsEof(); i++) {
+        PlayerInput input;
+        input.sequence = source.ReadUInt();
+        input.buttons = source.ReadUByte();
+        input.yaw = source.ReadFloat();
+        input.pitch = source.ReadFloat();
+        input.timeStep = source.ReadFloat();
+        input.sampleTime = -1.0f;
+        inputs.Push(input);
+    }
+}
+
+void InputQueue::Receive(const Controls& controls) {
+    VariantMap::ConstIterator buffer = controls.extraData_.Find(PLAYER_INPUTS);
+    if (buffer == controls.extraData_.End()) return;
+
+    MemoryBuffer source(buffer->second_.GetBuffer());
+    ReadPlayerInputs(source, received_);
+
+    // The same inputs are resent until acked, only the new ones are queued
+    for (unsigned i = 0; i < received_.Size(); i++) {
+        if (received_[i].sequence <= lastReceived_) continue;
+
+        queued_.Push(received_[i]);
+        lastReceived_ = received_[i].sequence;
+    }
+
+    if (queued_.Size() > MaxQueuedInputs) queued_.Erase(0, queued_.Size() - MaxQueuedInputs);
+}
+
+bool InputQueue::Pop(PlayerInput& input) {
+    if (queued_.Empty()) return false;
+
+    input = queued_.Front();
+    queued_.Erase(0);
+    lastApplied = input.sequence;
+    appliedTimer_.Reset();
+    return true;
+}
+
+unsigned InputQueue::GetApplyAge() {
+    return (unsigned)Min(appliedTimer_.GetUSec(false) / 1000, 65535LL);
+}
+
+void WritePlayerState(VectorBuffer& dest, unsigned ack, unsigned applyAge, const Player& player) {
+    dest.Clear();
+    dest.WriteUInt(ack);
+    dest.WriteUShort((unsigned short)applyAge);
+    dest.WriteVector3(player.pRigidBody->GetPosition());
+    dest.WriteVector3(player.pRigidBody->GetLinearVelocity());
+    dest.WriteFloat(player.yaw);
+    dest.WriteFloat(player.pitch);
+}
+
+void PlayerPredictor::Attach(Node* node) {
+    player.pNode = node;
+    player.pRigidBody = node->GetComponent<RigidBody>();
+    player.yaw = node->GetRotation().YawAngle();
+    player.pitch = node->GetRotation().PitchAngle();
+
+    // Replicated transform updates would overwrite the prediction, the server's state arrives through Reconcile instead
+    node->SetInterceptNetworkUpdate("Network Position", true);
+    node->SetInterceptNetworkUpdate("Network Rotation", true);
+    player.pRigidBody->SetInterceptNetworkUpdate("Linear Velocity", true);
+    player.pRigidBody->SetKinematic(false);
+}
+
+void PlayerPredictor::Detach() {
+    player = Player();
+    lastAck = 0;
+    lastError = 0.0f;
+    pending_.Clear();
+}
+
+void PlayerPredictor::Predict(const Controls& controls, float timeStep, float sampleTime) {
+    PlayerInput input;
+    input.sequence = nextSequence_++;
+    input.buttons = controls.buttons_;
+    input.yaw = controls.yaw_;
+    input.pitch = controls.pitch_;
+    input.timeStep = timeStep;
+    input.sampleTime = sampleTime;
+
+    if (pending_.Size() >= MaxPendingInputs) pending_.Erase(0);
+    pending_.Push(input);
+    if (latency && sampleTime >= 0.0f) latency->Predicted(sampleTime);
+
+    // Physics moves the body along the velocity set here, the same as on the server
+    player.ApplyControls(controls, timeStep);
+}
+
+void PlayerPredictor::WriteInputs(Controls& controls) {
+    WritePlayerInputs(buffer_, pending_);
+    controls.extraData_[PLAYER_INPUTS] = buffer_;
+}
+
+void PlayerPredictor::Reconcile(MemoryBuffer& message, float oneWay) {
+    unsigned ack = message.ReadUInt();
+    unsigned applyAge = message.ReadUShort();
+    Vector3 position = message.ReadVector3();
+    Vector3 velocity = message.ReadVector3();
+    float yaw = message.ReadFloat();
+    float pitch = message.ReadFloat();
+
+    // Unreliable: an older state than one already applied would rewind further than needed
+    if (!IsAttached() || ack < lastAck) return;
+    lastAck = ack;
+
+    unsigned acked = 0;
+    while (acked < pending_.Size() && pending_[acked].sequence <= ack) acked++;
+
+    // The newest acked input was applied applyAge before the state was sent, half a round trip ago
+    if (latency && acked && pending_[acked - 1].sampleTime >= 0.0f)
+        latency->Applied(latency->Now() - pending_[acked - 1].sampleTime - applyAge - oneWay);
+    pending_.Erase(0, acked);
+
+    Vector3 predicted = player.pRigidBody->GetPosition();
+
+    // Rewind to the server state, then replay what it has not seen. The player has no gravity and a velocity set
+    // directly from its input, so integrating that velocity reproduces a physics step closely enough.
+    player.yaw = yaw;
+    player.pitch = pitch;
+    player.pRigidBody->SetRotation(Quaternion(pitch, yaw, 0.0f));
+    player.pRigidBody->SetLinearVelocity(velocity);
+
+    for (unsigned i = 0; i < pending_.Size(); i++) {
+        player.ApplyControls(pending_[i].ToControls(), pending_[i].timeStep);
+        position += player.pRigidBody->GetLinearVelocity() * pending_[i].timeStep;
+    }
+
+    lastError = (predicted - position).Length();
+    player.pRigidBody->SetPosition(position);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <Urho3D/Container/Vector.h>
+#include <Urho3D/Input/Controls.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+#include <Urho3D/Core/Timer.h>
+
+#include "Player.h"
+
+class InputLatency;
+
+using namespace Urho3D;
+
+const static unsigned MaxPendingInputs = 64; // About a second of physics steps; older unacked inputs are dropped
+const static unsigned MaxQueuedInputs = 8; // Server side backlog before old inputs are skipped to catch up
+
+// One physics step of player input, numbered so the server can ack it
+struct PlayerInput {
+    unsigned sequence;
+    unsigned buttons;
+    float yaw, pitch;
+    float timeStep;
+    float sampleTime; // Client only: InputLatency time the input was read, -1 for none
+
+    Controls ToControls() const;
+    void ToControls(Controls& controls) const; // Into existing controls, without constructing their extraData_ map
+};
+
+void WritePlayerInputs(VectorBuffer& dest, const PODVector<PlayerInput>& inputs);
+void ReadPlayerInputs(MemoryBuffer& source, PODVector<PlayerInput>& inputs);
+
+// Server side: inputs of one connection, applied one per physics step in sequence order. Every unacked input is
+// resent with each controls update, so a lost packet is covered by the next one.
+class InputQueue {
+public:
+    unsigned lastApplied = 0; // Acked back to the client with the player's state
+
+    // Methods
+    void Receive(const Controls& controls);
+    bool Pop(PlayerInput& input);
+    unsigned GetApplyAge(); // Milliseconds since lastApplied was applied
+
+private:
+    unsigned lastReceived_ = 0;
+    HiresTimer appliedTimer_;
+    PODVector<PlayerInput> queued_;
+    PODVector<PlayerInput> received_;
+};
+
+void WritePlayerState(VectorBuffer& dest, unsigned ack, unsigned applyAge, const Player& player);
+
+// Client side: applies the local player's inputs immediately with Player::ApplyControls, and when the server's
+// authoritative state arrives rewinds to it and replays the inputs it has not processed yet
+class PlayerPredictor {
+public:
+    Player player;
+    unsigned lastAck = 0;
+    float lastError = 0.0f; // Distance between the predicted and reconciled position at the last correction
+    InputLatency* latency = nullptr;
+
+    // Methods
+    bool IsAttached() const { return player.pNode != nullptr; }
+    void Attach(Node* node);
+    void Detach();
+    void Predict(const Controls& controls, float timeStep, float sampleTime);
+    void WriteInputs(Controls& controls);
+    void Reconcile(MemoryBuffer& message, float oneWay);
+
+private:
+    unsigned nextSequence_ = 1;
+    PODVector<PlayerInput> pending_;
+    VectorBuffer buffer_;
+};
@@ -0,0 +1,88 @@
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/ParticleEffect.h>
+#include <Urho3D/Graphics/Texture2D.h>
+#include <Urho3D/Graphics/TextureCube.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Resource/ResourceEvents.h>
+
+#include "PackageLoader.h"
+#include "Preloader.h"
+
+const ManifestEntry ArenaManifest[] = {
+    // Textures first, so materials loaded from a mapped package find them cached
+    { Texture2D::GetTypeStatic(), "Textures/StoneDiffuse.dds" },
+    { Texture2D::GetTypeStatic(), "Textures/StoneNormal.dds" },
+    { Texture2D::GetTypeStatic(), "Textures/WaterNoise.dds" },
+    { Texture2D::GetTypeStatic(), "Textures/Red-scales.jpg" },
+    { Texture2D::GetTypeStatic(), "Textures/Green-scales.jpg" },
+    { TextureCube::GetTypeStatic(), "Textures/Skybox.xml" },
+    { Model::GetTypeStatic(), "Models/Box.mdl" },
+    { Model::GetTypeStatic(), "Models/Plane.mdl" },
+    { Model::GetTypeStatic(), "Models/TropicalFish01.mdl" },
+    { Model::GetTypeStatic(), "Models/Shark.mdl" },
+    { Material::GetTypeStatic(), "Materials/Stone.xml" },
+    { Material::GetTypeStatic(), "Materials/Water.xml" },
+    { Material::GetTypeStatic(), "Materials/Skybox.xml" },
+    { Material::GetTypeStatic(), "Materials/Red-Scales.xml" },
+    { Material::GetTypeStatic(), "Materials/Green-scales.xml" },
+    { ParticleEffect::GetTypeStatic(), "Particle/SnowExplosionBig.xml" },
+};
+const unsigned ArenaManifestSize = sizeof(ArenaManifest) / sizeof(ArenaManifest[0]);
+
+Preloader::Preloader(Context* context) : Object(context) {}
+
+void Preloader::Start(const ManifestEntry* manifest, unsigned count) {
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    PackageLoader* packages = GetSubsystem<PackageLoader>();
+
+    SubscribeToEvent(E_RESOURCEBACKGROUNDLOADED, URHO3D_HANDLER(Preloader, HandleResourceLoaded));
+    totalTimer_.Reset();
+    numTotal_ = count;
+    numPending_ = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+        // Resources in a mapped package are cheap enough to read synchronously
+        if (packages) {
+            long long start = totalTimer_.GetUSec(false);
+
+            if (packages->LoadResource(manifest[i].type, manifest[i].name)) {
+                URHO3D_LOGINFOF("Preload: %s mapped in %.2f ms", manifest[i].name, (totalTimer_.GetUSec(false) - start) / 1000.0f);
+                continue;
+            }
+        }
+
+        // Already cached or missing resources are not queued and never send an event
+        if (cache->BackgroundLoadResource(manifest[i].type, manifest[i].name, true)) {
+            requested_[StringHash(manifest[i].name)] = totalTimer_.GetUSec(false);
+            numPending_++;
+        }
+    }
+
+    URHO3D_LOGINFOF("Preload: queued %u of %u resources", numPending_, numTotal_);
+    if (packages) {
+        URHO3D_LOGINFOF("Preload: %u read in place and %u decompressed from %u mapped packages",
+            packages->numMapped, packages->numDecompressed, packages->GetNumPackages());
+    }
+}
+
+void Preloader::HandleResourceLoaded(StringHash eventType, VariantMap& eventData) {
+    using namespace ResourceBackgroundLoaded;
+
+    const String& name = eventData[P_RESOURCENAME].GetString();
+    HashMap<StringHash, long long>::Iterator i = requested_.Find(StringHash(name));
+    if (i == requested_.End()) return;
+
+    long long now = totalTimer_.GetUSec(false);
+    URHO3D_LOGINFOF("Preload: %s %s in %.2f ms", name.CString(), eventData[P_SUCCESS].GetBool() ? "loaded" : "FAILED",
+        (now - i->second_) / 1000.0f);
+
+    requested_.Erase(i);
+    numPending_--;
+
+    if (numPending_ == 0) {
+        URHO3D_LOGINFOF("Preload: finished in %.2f ms", now / 1000.0f);
+        UnsubscribeFromEvent(E_RESOURCEBACKGROUNDLOADED);
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Container/HashMap.h>
+
+using namespace Urho3D;
+
+// A resource the arena needs before it can be created
+struct ManifestEntry {
+    StringHash type;
+    const char* name;
+};
+
+// Everything CreateGameScene, Boid and Player load
+extern const ManifestEntry ArenaManifest[];
+extern const unsigned ArenaManifestSize;
+
+// Loads a manifest through the ResourceCache background loader and traces time per resource
+class Preloader : public Object {
+    URHO3D_OBJECT(Preloader, Object);
+
+public:
+    // Methods
+    Preloader(Context* context);
+    void Start(const ManifestEntry* manifest, unsigned count);
+    bool IsFinished() const { return numPending_ == 0; }
+    unsigned GetNumLoaded() const { return numTotal_ - numPending_; }
+    unsigned GetNumTotal() const { return numTotal_; }
+    float GetElapsed() { return totalTimer_.GetUSec(false) / 1000.0f; }
+
+private:
+    HashMap<StringHash, long long> requested_; // Request time (usec) per pending resource
+    HiresTimer totalTimer_;
+    unsigned numPending_ = 0;
+    unsigned numTotal_ = 0;
+
+    void HandleResourceLoaded(StringHash eventType, VariantMap& eventData);
+};
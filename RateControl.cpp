@@ -0,0 +1,39 @@
+#include "RateControl.h"
+
+static const float Window = 1.0f; // Seconds between adjustments
+static const float LossThreshold = 0.1f;
+static const float QueuingThreshold = 100.0f; // Milliseconds above the best round trip
+static const float BudgetStep = 2000.0f; // Bytes per second added per good window
+static const float BudgetBackoff = 0.7f;
+
+void RateControl::OnSent(unsigned bytes) {
+    windowBytes_ += bytes;
+    numSent_++;
+}
+
+void RateControl::Update(float timeStep, float currentRoundTrip, unsigned receivedCount) {
+    roundTrip = currentRoundTrip;
+    if (currentRoundTrip > 0.0f) minRoundTrip_ = Min(minRoundTrip_, currentRoundTrip);
+
+    windowTimer_ += timeStep;
+    if (windowTimer_ < Window) return;
+
+    // The client reports how many snapshots it has received in total, snapshots still in flight count as lost here
+    unsigned sent = numSent_ - sentAtWindow_;
+    unsigned received = receivedCount - receivedAtWindow_;
+    loss = sent ? Clamp(1.0f - (float)received / sent, 0.0f, 1.0f) : 0.0f;
+    usage = windowBytes_ / windowTimer_;
+
+    bool congested = loss > LossThreshold || roundTrip - minRoundTrip_ > QueuingThreshold;
+    if (congested) budget = Max(budget * BudgetBackoff, minBudget);
+    else budget = Min(budget + BudgetStep, maxBudget);
+
+    // Step down while over budget, back up only with plenty of headroom since the next level costs more
+    if (usage > budget && level + 1 < NumQualityLevels) level++;
+    else if (usage < budget * 0.5f && level > 0 && !congested) level--;
+
+    windowTimer_ = 0.0f;
+    windowBytes_ = 0;
+    sentAtWindow_ = numSent_;
+    receivedAtWindow_ = receivedCount;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <Urho3D/Math/MathDefs.h>
+
+using namespace Urho3D;
+
+// Snapshot quality steps, cheapest last. Far (mid tier) boids are thinned and hidden before the rate is lowered.
+struct QualityLevel {
+    unsigned sendInterval; // Snapshots go out every sendInterval network updates
+    unsigned midScale; // Mid tier boids are sent every midInterval * midScale snapshots, hidden from the client when 0
+};
+
+const static QualityLevel QualityLevels[] = {
+    { 1, 1 },
+    { 1, 2 },
+    { 1, 0 },
+    { 2, 0 },
+    { 4, 0 }
+};
+const static unsigned NumQualityLevels = sizeof(QualityLevels) / sizeof(QualityLevels[0]);
+
+// Per-connection congestion estimate. Once a second the byte budget grows additively, or shrinks multiplicatively when
+// snapshots are lost or the round trip rises well above the best seen (queuing). The quality level is then stepped
+// to keep the measured snapshot bandwidth within the budget.
+class RateControl {
+public:
+    float budget = 16000.0f; // Bytes per second
+    float minBudget = 2000.0f;
+    float maxBudget = 64000.0f;
+    float usage = 0.0f; // Snapshot bytes per second over the last window
+    float loss = 0.0f; // Fraction of snapshots lost over the last window
+    float roundTrip = 0.0f;
+    unsigned level = 0;
+
+    // Methods
+    void Update(float timeStep, float currentRoundTrip, unsigned receivedCount);
+    void OnSent(unsigned bytes);
+    const QualityLevel& GetQuality() const { return QualityLevels[level]; }
+
+private:
+    float minRoundTrip_ = M_INFINITY;
+    float windowTimer_ = 0.0f;
+    unsigned windowBytes_ = 0;
+    unsigned numSent_ = 0;
+    unsigned sentAtWindow_ = 0;
+    unsigned receivedAtWindow_ = 0;
+};
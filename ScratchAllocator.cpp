@@ -0,0 +1,114 @@
+#include <Urho3D/Core/WorkQueue.h>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifdef COUNT_HEAP_ALLOCATIONS
+#include <atomic>
+#endif
+
+#include "ScratchAllocator.h"
+
+#ifdef COUNT_HEAP_ALLOCATIONS
+static std::atomic<unsigned long long> heapAllocations(0);
+
+// Replacements for the global allocation functions, counting and otherwise plain malloc and free
+void* operator new(std::size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* pointer = malloc(size ? size : 1);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return operator new(size, std::nothrow); }
+void operator delete(void* pointer) noexcept { free(pointer); }
+void operator delete[](void* pointer) noexcept { free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { free(pointer); }
+
+unsigned long long GetHeapAllocations() {
+    return heapAllocations.load(std::memory_order_relaxed);
+}
+#else
+unsigned long long GetHeapAllocations() {
+    return 0;
+}
+#endif
+
+void* ScratchAllocator::Allocate(unsigned size, unsigned alignment) {
+    numAllocations++;
+
+    // Aligned against the real address, the block's own alignment is whatever the heap gave it
+    uintptr_t base = (uintptr_t)block_.Buffer();
+    unsigned start = (unsigned)(((base + offset_ + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base);
+    if (start + size <= block_.Size()) {
+        offset_ = start + size;
+        peakBytes = Max(peakBytes, offset_ + overflowBytes_);
+        return block_.Buffer() + start;
+    }
+
+    overflow_.Resize(overflow_.Size() + 1);
+    overflow_.Back().Resize(size + alignment);
+    overflowBytes_ += size + alignment;
+    numOverflowAllocations++;
+    peakBytes = Max(peakBytes, offset_ + overflowBytes_);
+
+    base = (uintptr_t)overflow_.Back().Buffer();
+    return (void*)((base + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+void ScratchAllocator::Rewind(const ScratchMark& mark) {
+    // Overflow blocks taken since the mark go straight back, so one oversized allocation doesn't push every later one
+    // out of the block too
+    while (overflow_.Size() > mark.numOverflow) {
+        overflowBytes_ -= overflow_.Back().Size();
+        overflow_.Pop();
+    }
+    if (mark.offset <= offset_) offset_ = mark.offset;
+}
+
+void ScratchAllocator::Reset() {
+    // Room for the most this tick had in use at once, in one block from now on
+    if (numOverflowAllocations) {
+        block_.Resize(0);
+        block_.Resize(peakBytes + peakBytes / 4);
+    }
+
+    overflow_.Clear();
+    overflowBytes_ = 0;
+    offset_ = 0;
+    numAllocations = 0;
+    numOverflowAllocations = 0;
+    peakBytes = 0;
+}
+
+TickScratch::TickScratch(Context* context) : Object(context), allocators_(GetSubsystem<WorkQueue>()->GetNumThreads() + 1) {}
+
+void TickScratch::BeginTick() {
+    tickHeapStart_ = GetHeapAllocations();
+}
+
+void TickScratch::EndTick() {
+    lastTick = ScratchStats();
+    lastTick.heapAllocations = (unsigned)(GetHeapAllocations() - tickHeapStart_);
+    if (lastTick.heapAllocations) heapTicks++;
+
+    for (unsigned i = 0; i < allocators_.Size(); i++) {
+        lastTick.allocations += allocators_[i].numAllocations;
+        lastTick.overflowAllocations += allocators_[i].numOverflowAllocations;
+        lastTick.bytes += allocators_[i].peakBytes;
+        allocators_[i].Reset();
+    }
+
+    if (lastTick.overflowAllocations) overflowTicks++;
+}
+
+unsigned TickScratch::GetMemoryUse() const {
+    unsigned bytes = 0;
+    for (unsigned i = 0; i < allocators_.Size(); i++) bytes += allocators_[i].GetMemoryUse();
+    return bytes;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Container/Vector.h>
+
+using namespace Urho3D;
+
+const static unsigned ScratchBlockSize = 64 * 1024; // Initial block per thread, grown to the largest tick seen
+#ifdef COUNT_HEAP_ALLOCATIONS
+const static bool CountHeapAllocations = true;
+#else
+const static bool CountHeapAllocations = false; // Build with COUNT_HEAP_ALLOCATIONS to count every operator new
+#endif
+
+// Calls to the global operator new since start, on any thread; 0 unless CountHeapAllocations. Bullet and other C
+// libraries that call malloc directly are not seen.
+unsigned long long GetHeapAllocations();
+
+// Position in a ScratchAllocator to rewind to
+struct ScratchMark {
+    unsigned offset;
+    unsigned numOverflow;
+};
+
+// Bump allocator for data that lives for one tick: an allocation is an offset increment, and everything is given back
+// at once by Reset. An allocation the block has no room for takes an overflow block from the heap, given back by the
+// Rewind or Reset that covers it; the next Reset grows the block to the most that was in use at once, so steady state
+// ticks don't overflow. Not thread safe, each thread has its own.
+class ScratchAllocator {
+public:
+    unsigned numAllocations = 0; // Since the last Reset
+    unsigned numOverflowAllocations = 0; // Overflow blocks since the last Reset
+    unsigned peakBytes = 0; // Most in use at once since the last Reset
+
+    // Methods
+    ScratchAllocator() : block_(ScratchBlockSize) {}
+    void* Allocate(unsigned size, unsigned alignment = 16);
+    template <class T> T* Allocate(unsigned count) { return static_cast<T*>(Allocate(count * sizeof(T), alignof(T))); }
+    ScratchMark GetMark() const { ScratchMark mark = { offset_, overflow_.Size() }; return mark; }
+    void Rewind(const ScratchMark& mark); // Gives back everything allocated since GetMark returned mark
+    void Reset();
+    unsigned GetMemoryUse() const { return block_.Capacity() + overflowBytes_; }
+
+private:
+    PODVector<unsigned char> block_;
+    unsigned offset_ = 0;
+    Vector<PODVector<unsigned char> > overflow_;
+    unsigned overflowBytes_ = 0; // In the overflow blocks still held
+};
+
+// What the scratch allocators of every thread did in one tick, and how often the tick reached the heap besides
+struct ScratchStats {
+    unsigned allocations = 0;
+    unsigned overflowAllocations = 0;
+    unsigned bytes = 0; // Sum of each thread's peak
+    unsigned heapAllocations = 0; // Every operator new between BeginTick and EndTick, when CountHeapAllocations
+};
+
+// Subsystem owning one ScratchAllocator per work queue thread. The server brackets each fixed step with BeginTick and
+// EndTick, which resets them all.
+class TickScratch : public Object {
+    URHO3D_OBJECT(TickScratch, Object);
+
+public:
+    ScratchStats lastTick;
+    unsigned overflowTicks = 0; // Ticks since start in which a scratch allocator overflowed its block
+    unsigned heapTicks = 0; // Ticks since start with any heap allocation, when CountHeapAllocations
+
+    // Methods
+    TickScratch(Context* context);
+    ScratchAllocator& Get(unsigned threadIndex) { return allocators_[threadIndex]; } // 0 is the main thread, as in work items
+    void BeginTick();
+    void EndTick();
+    unsigned GetMemoryUse() const;
+
+private:
+    Vector<ScratchAllocator> allocators_;
+    unsigned long long tickHeapStart_ = 0;
+};
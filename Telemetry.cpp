@@ -0,0 +1,224 @@
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Network/Connection.h>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "Telemetry.h"
+#include "LoadTest.h"
+#include "MemoryReport.h"
+#include "NetStats.h"
+
+unsigned long long GetProcessMemory() {
+#ifdef __linux__
+    // Second field of statm is the resident set, in pages
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file) return 0;
+
+    unsigned long long size = 0, resident = 0;
+    bool read = fscanf(file, "%llu %llu", &size, &resident) == 2;
+    fclose(file);
+    return read ? resident * (unsigned long long)sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+TelemetryWriter::~TelemetryWriter() {
+    Stop();
+}
+
+bool TelemetryWriter::Push(const String& record) {
+    unsigned pushed = pushed_.load(std::memory_order_relaxed);
+    if (pushed - popped_.load(std::memory_order_acquire) >= TelemetryQueueSize) return false;
+
+    records_[pushed % TelemetryQueueSize] = record;
+    pushed_.store(pushed + 1, std::memory_order_release);
+    return true;
+}
+
+void TelemetryWriter::ThreadFunction() {
+    bool failed = false;
+
+    for (;;) {
+        unsigned popped = popped_.load(std::memory_order_relaxed);
+        if (popped == pushed_.load(std::memory_order_acquire)) {
+            // Drain what is queued before stopping
+            if (!shouldRun_) break;
+            Time::Sleep(10);
+            continue;
+        }
+
+        // A reader that went away is retried with the next record, the ones in between are lost
+        bool written = (file_ || socket_ >= 0 || Open()) && Write(records_[popped % TelemetryQueueSize]);
+        if (!written) Close();
+        if (written == failed) {
+            if (written) URHO3D_LOGINFOF("Telemetry: writing to %s", path.CString());
+            else URHO3D_LOGWARNINGF("Telemetry: could not write to %s", path.CString());
+            failed = !written;
+        }
+
+        popped_.store(popped + 1, std::memory_order_release);
+    }
+
+    Close();
+}
+
+bool TelemetryWriter::Open() {
+#ifndef _WIN32
+    if (path.StartsWith("unix:")) {
+        socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (socket_ < 0) return false;
+
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, path.Substring(5).CString(), sizeof(address.sun_path) - 1);
+        if (connect(socket_, (struct sockaddr*)&address, sizeof(address)) != 0) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+#endif
+
+    file_ = fopen(path.CString(), "a");
+    return file_ != nullptr;
+}
+
+bool TelemetryWriter::Write(const String& record) {
+    if (file_) return fputs(record.CString(), file_) >= 0 && fflush(file_) == 0;
+
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL; // A closed socket is an error here, not a SIGPIPE
+#else
+    const int flags = 0;
+#endif
+    for (unsigned sent = 0; sent < record.Length();) {
+        ssize_t bytes = send(socket_, record.CString() + sent, record.Length() - sent, flags);
+        if (bytes <= 0) return false;
+        sent += (unsigned)bytes;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TelemetryWriter::Close() {
+    if (file_) fclose(file_);
+    file_ = nullptr;
+
+#ifndef _WIN32
+    if (socket_ >= 0) close(socket_);
+#endif
+    socket_ = -1;
+}
+
+Telemetry::Telemetry(Context* context) : Object(context) {}
+
+Telemetry::~Telemetry() {
+    writer_.Stop();
+}
+
+void Telemetry::Start(const String& path) {
+    writer_.Stop();
+    writer_.path = path;
+    writer_.Run();
+
+    SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(Telemetry, HandleBeginFrame));
+    SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(Telemetry, HandleEndFrame));
+    URHO3D_LOGINFOF("Telemetry: a record every %.0f s to %s", interval, path.CString());
+}
+
+void Telemetry::Update(float timeStep, const Vector<SharedPtr<Arena> >& arenas) {
+    if (!writer_.IsStarted()) return;
+
+    timer_ += timeStep;
+    if (timer_ < interval) return;
+
+    NetStats* stats = GetSubsystem<NetStats>();
+    unsigned numTicks = tickTimes_.Size();
+    float tickMean = 0.0f;
+    for (unsigned i = 0; i < numTicks; i++) tickMean += tickTimes_[i];
+    if (numTicks) tickMean /= numTicks;
+    float tickP50 = Percentile(tickTimes_, 0.5f);
+    float tickP95 = Percentile(tickTimes_, 0.95f);
+    float tickP99 = Percentile(tickTimes_, 0.99f);
+    float tickMax = numTicks ? tickTimes_.Back() : 0.0f; // Sorted by Percentile
+
+    record_.Clear();
+    record_.AppendWithFormat("{\"time\":%.3f,\"interval\":%.3f,\"ticks\":%u,\"tick_ms\":{\"mean\":%.3f,\"p50\":%.3f,\"p95\":%.3f,"
+        "\"p99\":%.3f,\"max\":%.3f},\"dropped_frames\":%u,\"memory_bytes\":%llu", GetSubsystem<Time>()->GetElapsedTime(), timer_,
+        numTicks, tickMean, tickP50, tickP95, tickP99, tickMax, droppedFrames_, GetProcessMemory());
+
+    record_ += ",\"arenas\":[";
+    for (unsigned i = 0; i < arenas.Size(); i++) {
+        Arena* arena = arenas[i];
+        unsigned numNear = 0, numMid = 0, numSent = 0;
+        String connections;
+
+        for (unsigned j = 0; j < arena->connections.Size(); j++) {
+            Connection* connection = arena->connections[j];
+            const SnapshotView* view = arena->snapshots.GetView(connection);
+            const ConnectionStats* connectionStats = stats ? stats->GetStats(connection) : nullptr;
+            if (view) {
+                numNear += view->numNear;
+                numMid += view->numMid;
+                numSent += view->numSent;
+            }
+
+            if (j) connections += ',';
+            connections.AppendWithFormat("{\"address\":\"%s\",\"bytes_out\":%.0f,\"snapshot_bytes\":%.0f,\"rtt\":%.0f,\"quality\":%u}",
+                connection->ToString().CString(), connectionStats ? connectionStats->bytesOutPerSec : 0.0f,
+                connectionStats ? connectionStats->channelPerSec[NET_SNAPSHOTS] : 0.0f, connectionStats ? connectionStats->roundTrip : 0.0f,
+                view ? view->rate.level : 0);
+        }
+
+        if (i) record_ += ',';
+        record_.AppendWithFormat("{\"index\":%u,\"boids\":%u,\"players\":%u,\"regions_active\":%u,\"flock_ms\":%.3f,"
+            "\"lod\":{\"near\":%u,\"mid\":%u,\"sent\":%u},\"connections\":[%s]}", arena->index, arena->boids.boidList.Size(),
+            arena->players.Size(), arena->boids.numActiveRegions, arena->flockTime, numNear, numMid, numSent, connections.CString());
+    }
+    record_ += ']';
+
+    // Scratch use of the tick before this one, how many ticks have overflowed the scratch blocks, and in builds that
+    // count them, the tick's heap allocations and how many ticks allocated at all
+    TickScratch* scratch = GetSubsystem<TickScratch>();
+    if (scratch) {
+        record_.AppendWithFormat(",\"scratch\":{\"allocations\":%u,\"bytes\":%u,\"overflow_allocations\":%u,\"overflow_ticks\":%u",
+            scratch->lastTick.allocations, scratch->lastTick.bytes, scratch->lastTick.overflowAllocations, scratch->overflowTicks);
+        if (CountHeapAllocations) {
+            record_.AppendWithFormat(",\"heap_allocations\":%u,\"heap_ticks\":%u", scratch->lastTick.heapAllocations, scratch->heapTicks);
+        }
+        record_ += '}';
+    }
+    MemoryReport* memory = GetSubsystem<MemoryReport>();
+    if (memory) {
+        memory->Measure();
+        record_ += ",\"memory\":" + memory->GetJson();
+    }
+    record_.AppendWithFormat(",\"dropped_records\":%u}\n", droppedRecords_);
+
+    if (!writer_.Push(record_)) droppedRecords_++;
+
+    tickTimes_.Clear();
+    droppedFrames_ = 0;
+    timer_ = 0.0f;
+}
+
+void Telemetry::HandleBeginFrame(StringHash eventType, VariantMap& eventData) {
+    tickTimer_.Reset();
+}
+
+void Telemetry::HandleEndFrame(StringHash eventType, VariantMap& eventData) {
+    float tickTime = tickTimer_.GetUSec(false) / 1000.0f;
+    tickTimes_.Push(tickTime);
+    if (tickTime > tickBudget) droppedFrames_++;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/Core/Timer.h>
+#include <atomic>
+#include <cstdio>
+
+#include "Arena.h"
+
+using namespace Urho3D;
+
+const static unsigned TelemetryQueueSize = 16; // Records waiting for the writer, more are dropped rather than blocking
+
+// Writes telemetry records on its own thread, to a file or, for paths starting with "unix:", a local stream socket.
+// The tick thread hands records over through a single producer, single consumer ring, so it never waits on the output.
+class TelemetryWriter : public Thread {
+public:
+    String path;
+
+    // Methods
+    ~TelemetryWriter();
+    bool Push(const String& record); // False when the ring is full
+    virtual void ThreadFunction();
+
+private:
+    String records_[TelemetryQueueSize];
+    std::atomic<unsigned> pushed_{0};
+    std::atomic<unsigned> popped_{0};
+    FILE* file_ = nullptr;
+    int socket_ = -1;
+
+    bool Open();
+    bool Write(const String& record);
+    void Close();
+};
+
+// Server subsystem emitting a JSON-lines record every interval seconds: tick time percentiles and frames over budget,
+// boid, player and connection counts, snapshot interest tiers, bytes sent per connection, and process memory with
+// the MemoryReport breakdown
+class Telemetry : public Object {
+    URHO3D_OBJECT(Telemetry, Object);
+
+public:
+    float interval = 5.0f;
+    float tickBudget = 1000.0f / 60.0f; // Milliseconds, longer ticks are counted as dropped frames
+
+    // Methods
+    Telemetry(Context* context);
+    ~Telemetry();
+    void Start(const String& path);
+    void Update(float timeStep, const Vector<SharedPtr<Arena> >& arenas);
+
+private:
+    TelemetryWriter writer_;
+    HiresTimer tickTimer_;
+    PODVector<float> tickTimes_; // Milliseconds, since the last record
+    unsigned droppedFrames_ = 0;
+    unsigned droppedRecords_ = 0;
+    float timer_ = 0.0f;
+    String record_;
+
+    void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+    void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+};
+
+unsigned long long GetProcessMemory(); // Resident bytes, 0 where not supported